@@ -25,12 +25,15 @@ LOCAL_SRC_FILES += \
 	Main/FrameBufferAndroid.cpp \
 	Main/Logo.cpp \
 	Main/Register.cpp \
+	Main/RoutineStatistics.cpp \
 	Main/SwiftConfig.cpp \
 	Main/crc.cpp \
 	Main/serialvalid.cpp \
 
 LOCAL_SRC_FILES += \
+	Reactor/CodeHeap.cpp \
 	Reactor/Nucleus.cpp \
+	Reactor/PrecacheFile.cpp \
 	Reactor/Routine.cpp \
 	Reactor/RoutineManager.cpp
 
@@ -46,6 +49,8 @@ LOCAL_SRC_FILES += \
 	Renderer/QuadRasterizer.cpp \
 	Renderer/Rasterizer.cpp \
 	Renderer/Renderer.cpp \
+	Renderer/RoutineCache.cpp \
+	Renderer/RoutineCompiler.cpp \
 	Renderer/Sampler.cpp \
 	Renderer/SetupProcessor.cpp \
 	Renderer/Surface.cpp \
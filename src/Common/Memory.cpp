@@ -114,7 +114,17 @@ void markExecutable(void *memory, size_t bytes)
 	#endif
 }
 
-void deallocateExecutable(void *memory, size_t bytes)
+void markWritableExecutable(void *memory, size_t bytes)
+{
+	#if defined(_WIN32)
+		unsigned long oldProtection;
+		VirtualProtect(memory, bytes, PAGE_EXECUTE_READWRITE, &oldProtection);
+	#else
+		mprotect(memory, bytes, PROT_READ | PROT_WRITE | PROT_EXEC);
+	#endif
+}
+
+void markWritable(void *memory, size_t bytes)
 {
 	#if defined(_WIN32)
 		unsigned long oldProtection;
@@ -122,7 +132,11 @@ void deallocateExecutable(void *memory, size_t bytes)
 	#else
 		mprotect(memory, bytes, PROT_READ | PROT_WRITE);
 	#endif
+}
 
+void deallocateExecutable(void *memory, size_t bytes)
+{
+	markWritable(memory, bytes);
 	deallocate(memory);
 }
 }
@@ -24,6 +24,8 @@ void deallocate(void *memory);
 
 void *allocateExecutable(size_t bytes);   // Allocates memory that can be made executable using markExecutable()
 void markExecutable(void *memory, size_t bytes);
+void markWritableExecutable(void *memory, size_t bytes);   // For code written next to running code
+void markWritable(void *memory, size_t bytes);
 void deallocateExecutable(void *memory, size_t bytes);
 }
 
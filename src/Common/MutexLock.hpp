@@ -117,6 +117,169 @@ namespace sw
 		volatile int mutex;
 		volatile int b[15];
 	};
+
+	// Spinning lock held either by any number of readers or by one writer. A waiting writer
+	// keeps new readers out, so a steady stream of lookups can't starve modifications.
+	class ReadWriteLock
+	{
+	public:
+		ReadWriteLock()
+		{
+			state = 0;
+		}
+
+		void lockShared()
+		{
+			while(true)
+			{
+				int readers = state;
+
+				if(!(readers & WRITER) && atomicCompareExchange(&state, readers + 1, readers) == readers)
+				{
+					return;
+				}
+
+				pause();
+			}
+		}
+
+		void unlockShared()
+		{
+			atomicDecrement(&state);
+		}
+
+		void lock()
+		{
+			while(true)
+			{
+				int readers = state;
+
+				if(!(readers & WRITER) && atomicCompareExchange(&state, readers | WRITER, readers) == readers)
+				{
+					break;
+				}
+
+				Thread::yield();
+			}
+
+			while(state != WRITER)   // Wait for the readers to leave
+			{
+				pause();
+			}
+		}
+
+		void unlock()
+		{
+			atomicExchange(&state, 0);
+		}
+
+	private:
+		enum {WRITER = 0x40000000};
+
+		// Reader count, plus the writer bit. On its own 64-byte cache line to avoid false sharing.
+		volatile int a[16];
+		volatile int state;
+		volatile int b[15];
+	};
+
+	// Lock which parks contending threads, for sections that can be held long or by more threads than cores
+	class MutexLock
+	{
+	public:
+		MutexLock()
+		{
+			#if defined(__linux__)
+				state = 0;
+				spinCount = 0;
+			#elif defined(_WIN32)
+				InitializeCriticalSectionAndSpinCount(&handle, 4000);
+			#else
+				pthread_mutex_init(&handle, 0);
+			#endif
+		}
+
+		~MutexLock()
+		{
+			#if defined(_WIN32)
+				DeleteCriticalSection(&handle);
+			#elif !defined(__linux__)   // Futexes need no cleanup
+				pthread_mutex_destroy(&handle);
+			#endif
+		}
+
+		bool attemptLock()
+		{
+			#if defined(__linux__)
+				return state == 0 && atomicCompareExchange(&state, 1, 0) == 0;
+			#elif defined(_WIN32)
+				return TryEnterCriticalSection(&handle) != FALSE;
+			#else
+				return pthread_mutex_trylock(&handle) == 0;
+			#endif
+		}
+
+		void lock()
+		{
+			#if defined(__linux__)
+				int limit = 2 * spinCount + 16;
+
+				if(limit > SPIN_LIMIT)
+				{
+					limit = SPIN_LIMIT;
+				}
+
+				for(int spin = 0; spin < limit; spin++)
+				{
+					if(attemptLock())
+					{
+						spinCount += (spin - spinCount) / 8;
+
+						return;
+					}
+
+					pause();
+				}
+
+				spinCount /= 2;
+
+				// Locked with 2 when the lock was free, so unlocking wakes the threads still parked
+				while(atomicExchange(&state, 2) != 0)
+				{
+					futexWait(&state, 2);
+				}
+			#elif defined(_WIN32)
+				EnterCriticalSection(&handle);
+			#else
+				pthread_mutex_lock(&handle);
+			#endif
+		}
+
+		void unlock()
+		{
+			#if defined(__linux__)
+				if(atomicExchange(&state, 0) == 2)
+				{
+					futexWake(&state, 1);
+				}
+			#elif defined(_WIN32)
+				LeaveCriticalSection(&handle);
+			#else
+				pthread_mutex_unlock(&handle);
+			#endif
+		}
+
+	private:
+		#if defined(__linux__)
+			enum {SPIN_LIMIT = 4096};
+
+			volatile int state;   // Futex word: 0 when unlocked, 1 when locked, 2 when threads may be parked
+			int spinCount;        // Average spinning it took to get the lock, shared by all threads
+		#elif defined(_WIN32)
+			CRITICAL_SECTION handle;
+		#else
+			pthread_mutex_t handle;
+		#endif
+	};
 }
 
 #endif   // sw_MutexLock_hpp
@@ -11,6 +11,11 @@
 
 #include "Thread.hpp"
 
+#if defined(__linux__)
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+#endif
+
 namespace sw
 {
 	Thread::Thread(void (*threadFunction)(void *parameters), void *parameters)
@@ -63,6 +68,9 @@ namespace sw
 	{
 		#if defined(_WIN32)
 			handle = CreateEvent(0, FALSE, FALSE, 0);
+		#elif defined(__linux__)
+			state = 0;
+			spinCount = 0;
 		#else
 			pthread_cond_init(&handle, 0);
 			pthread_mutex_init(&mutex, 0);
@@ -74,9 +82,21 @@ namespace sw
 	{
 		#if defined(_WIN32)
 			CloseHandle(handle);
-		#else
+		#elif !defined(__linux__)   // Futexes need no cleanup
 			pthread_cond_destroy(&handle);
 			pthread_mutex_destroy(&mutex);
 		#endif
 	}
+
+	#if defined(__linux__)
+		void futexWait(volatile int *address, int value)
+		{
+			syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, value, 0, 0, 0);   // Also returns on signals and spuriously
+		}
+
+		void futexWake(volatile int *address, int count)
+		{
+			syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, count, 0, 0, 0);
+		}
+	#endif
 }
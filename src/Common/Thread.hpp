@@ -12,6 +12,8 @@
 #ifndef sw_Thread_hpp
 #define sw_Thread_hpp
 
+#include "Types.hpp"
+
 #if defined(_WIN32)
 	#ifndef WIN32_LEAN_AND_MEAN
 		#define WIN32_LEAN_AND_MEAN
@@ -84,6 +86,11 @@ namespace sw
 	private:
 		#if defined(_WIN32)
 			HANDLE handle;
+		#elif defined(__linux__)
+			enum {SPIN_LIMIT = 4096};
+
+			volatile int state;   // Futex word: 0 when not signaled, 1 when signaled, 2 when threads may be parked
+			int spinCount;        // Average spinning it took to catch a signal
 		#else
 			pthread_cond_t handle;
 			pthread_mutex_t mutex;
@@ -91,15 +98,19 @@ namespace sw
 		#endif
 	};
 
-	#if PERF_PROFILE
-	int64_t atomicExchange(int64_t volatile *target, int64_t value);
+	#if defined(__linux__)
+		void futexWait(volatile int *address, int value);   // Parks the thread unless the value changed
+		void futexWake(volatile int *address, int count);
 	#endif
 
+	int64_t atomicExchange(int64_t volatile *target, int64_t value);
 	int atomicExchange(int volatile *target, int value);
 	int atomicIncrement(int volatile *value);
 	int atomicDecrement(int volatile *value);
 	int atomicAdd(int volatile *target, int value);
+	int atomicCompareExchange(int volatile *target, int exchange, int comparand);   // Returns the original value
 	void nop();
+	void pause();   // Spin-wait hint
 }
 
 namespace sw
@@ -168,6 +179,11 @@ namespace sw
 	{
 		#if defined(_WIN32)
 			SetEvent(handle);
+		#elif defined(__linux__)
+			if(atomicExchange(&state, 1) == 2)
+			{
+				futexWake(&state, 1);   // Straight to the waiter, without a mutex to reacquire
+			}
 		#else
 			pthread_mutex_lock(&mutex);
 			signaled = true;
@@ -180,6 +196,34 @@ namespace sw
 	{
 		#if defined(_WIN32)
 			WaitForSingleObject(handle, INFINITE);
+		#elif defined(__linux__)
+			int limit = 2 * spinCount + 16;
+
+			if(limit > SPIN_LIMIT)
+			{
+				limit = SPIN_LIMIT;
+			}
+
+			for(int spin = 0; spin < limit; spin++)
+			{
+				if(state == 1 && atomicCompareExchange(&state, 0, 1) == 1)
+				{
+					spinCount += (spin - spinCount) / 8;
+
+					return;
+				}
+
+				pause();
+			}
+
+			spinCount /= 2;   // Spin less while signals keep arriving late
+
+			// Takes the signal if there is one, otherwise makes signal() wake a parked thread.
+			// Taking it after being woken leaves 2 in case other threads are still parked.
+			while(atomicExchange(&state, 2) != 1)
+			{
+				futexWait(&state, 2);
+			}
 		#else
 			pthread_mutex_lock(&mutex);
 			while(!signaled) pthread_cond_wait(&handle, &mutex);
@@ -188,18 +232,14 @@ namespace sw
 		#endif
 	}
 
-	#if PERF_PROFILE
 	inline int64_t atomicExchange(volatile int64_t *target, int64_t value)
 	{
 		#if defined(_WIN32)
 			return InterlockedExchange64(target, value);
 		#else
-			int ret;
-			__asm__ __volatile__("lock; xchg8 %0,(%1)" : "=r" (ret) :"r" (target), "0" (value) : "memory" );
-			return ret;
+			return __sync_lock_test_and_set(target, value);
 		#endif
 	}
-	#endif
 
 	inline int atomicExchange(volatile int *target, int value)
 	{
@@ -239,6 +279,15 @@ namespace sw
 		#endif
 	}
 
+	inline int atomicCompareExchange(volatile int *target, int exchange, int comparand)
+	{
+		#if defined(_WIN32)
+			return InterlockedCompareExchange((volatile long*)target, exchange, comparand);
+		#else
+			return __sync_val_compare_and_swap(target, comparand, exchange);
+		#endif
+	}
+
 	inline void nop()
 	{
 		#if defined(_WIN32)
@@ -247,6 +296,15 @@ namespace sw
 			__asm__ __volatile__ ("nop");
 		#endif
 	}
+
+	inline void pause()
+	{
+		#if defined(_WIN32)
+			YieldProcessor();
+		#else
+			__asm__ __volatile__ ("pause" ::: "memory");
+		#endif
+	}
 }
 
 #endif   // sw_Thread_hpp
@@ -48,9 +48,7 @@ namespace sw
 		#if defined(_WIN32)
 			return __rdtsc();
 		#else
-			int64_t tsc;
-			__asm volatile("rdtsc": "=A" (tsc));
-			return tsc;
+			return __rdtsc();   // The "=A" constraint only reads EDX:EAX on 32-bit
 		#endif
 	}
 
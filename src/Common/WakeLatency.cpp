@@ -0,0 +1,96 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+
+// Measures the round trip of waking a thread through an Event and being woken back, like the
+// renderer resumes its workers and waits for them to suspend. Round trips are timed both
+// back-to-back, which the spinning catches, and after an idle gap, which parks the thread.
+//
+// Usage: swwakelatency [iterations]
+
+#include "Thread.hpp"
+#include "Timer.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+struct PingPong
+{
+	sw::Event ping;
+	sw::Event pong;
+	int iterations;
+};
+
+static void pongFunction(void *parameters)
+{
+	PingPong *pingPong = static_cast<PingPong*>(parameters);
+
+	for(int i = 0; i < pingPong->iterations; i++)
+	{
+		pingPong->ping.wait();
+		pingPong->pong.signal();
+	}
+}
+
+static int64_t roundTrip(int iterations, int idleMilliseconds)
+{
+	PingPong pingPong;
+	pingPong.iterations = iterations;
+
+	sw::Thread thread(pongFunction, &pingPong);
+
+	int64_t ticks = 0;
+
+	for(int i = 0; i < iterations; i++)
+	{
+		if(idleMilliseconds > 0)
+		{
+			sw::Thread::sleep(idleMilliseconds);
+		}
+
+		int64_t start = sw::Timer::ticks();
+
+		pingPong.ping.signal();
+		pingPong.pong.wait();
+
+		ticks += sw::Timer::ticks() - start;
+	}
+
+	thread.join();
+
+	return ticks / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+
+	if(iterations < 1)
+	{
+		fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+
+		return 1;
+	}
+
+	// Calibrate the time stamp counter against wall clock time
+	double startSeconds = sw::Timer::seconds();
+	int64_t startTicks = sw::Timer::ticks();
+	sw::Thread::sleep(100);
+	double ticksPerNanosecond = (sw::Timer::ticks() - startTicks) / ((sw::Timer::seconds() - startSeconds) * 1.0e9);
+
+	int64_t busy = roundTrip(iterations, 0);
+	int64_t idle = roundTrip(iterations / 1000 + 10, 2);
+
+	printf("Back-to-back round trip: %lld cycles (%.0f ns)\n", (long long)busy, busy / ticksPerNanosecond);
+	printf("Round trip after idling: %lld cycles (%.0f ns)\n", (long long)idle, idle / ticksPerNanosecond);
+
+	return 0;
+}
@@ -80,10 +80,6 @@ namespace D3D9
 
 		TRACE("");
 
-		#if PERF_PROFILE
-			profiler.nextFrame();
-		#endif
-
 		#if PERF_HUD
 			sw::Renderer *renderer = device->renderer;
 
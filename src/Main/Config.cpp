@@ -26,38 +26,35 @@ void Profiler::reset()
 	framesSec = 0;
 	framesTotal = 0;
 	FPS = 0;
-	
-	#if PERF_PROFILE
-		for(int i = 0; i < PERF_TIMERS; i++)
-		{
-			cycles[i] = 0;
-		}
+	unoptimizedDraws = 0;
 
-		ropOperations = 0;
-		ropOperationsTotal = 0;
-		ropOperationsFrame = 0;
-	
-		texOperations = 0;
-		texOperationsTotal = 0;
-		texOperationsFrame = 0;
-	
-		compressedTex = 0;
-		compressedTexTotal = 0;
-		compressedTexFrame = 0;
-	#endif
+	for(int i = 0; i < PERF_TIMERS; i++)
+	{
+		cycles[i] = 0;
+	}
+
+	ropOperations = 0;
+	ropOperationsTotal = 0;
+	ropOperationsFrame = 0;
+
+	texOperations = 0;
+	texOperationsTotal = 0;
+	texOperationsFrame = 0;
+
+	compressedTex = 0;
+	compressedTexTotal = 0;
+	compressedTexFrame = 0;
 };
 
 void Profiler::nextFrame()
 {
-	#if PERF_PROFILE
-		ropOperationsFrame = sw::atomicExchange(&ropOperations, 0);
-		texOperationsFrame = sw::atomicExchange(&texOperations, 0);
-		compressedTexFrame = sw::atomicExchange(&compressedTex, 0);
+	ropOperationsFrame = sw::atomicExchange(&ropOperations, 0);
+	texOperationsFrame = sw::atomicExchange(&texOperations, 0);
+	compressedTexFrame = sw::atomicExchange(&compressedTex, 0);
 
-		ropOperationsTotal += ropOperationsFrame;
-		texOperationsTotal += texOperationsFrame;
-		compressedTexTotal += compressedTexFrame;
-	#endif
+	ropOperationsTotal += ropOperationsFrame;
+	texOperationsTotal += texOperationsFrame;
+	compressedTexTotal += compressedTexFrame;
 
 	static double fpsTime = sw::Timer::seconds();
 
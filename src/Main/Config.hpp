@@ -15,7 +15,6 @@
 #include "Common/Types.hpp"
 
 #define PERF_HUD 0       // Display time spent on vertex, setup and pixel processing for each thread
-#define PERF_PROFILE 0   // Profile various pipeline stages and display the timing in SwiftConfig
 #if defined(_WIN32)
 #define S3TC_SUPPORT 1
 #else
@@ -45,7 +44,9 @@ struct Profiler
 	int framesTotal;
 	double FPS;
 
-	#if PERF_PROFILE
+	int unoptimizedDraws;   // Draws which used an unoptimized pixel routine
+
+	// Pipeline stages, counted by routines generated while pipeline profiling is enabled
 	double cycles[PERF_TIMERS];
 
 	int64_t ropOperations;
@@ -59,14 +60,15 @@ struct Profiler
 	int64_t compressedTex;
 	int64_t compressedTexTotal;
 	int64_t compressedTexFrame;
-	#endif
 };
 
 extern Profiler profiler;
 
 enum
 {
-	OUTLINE_RESOLUTION = 4096,   // Maximum vertical resolution of the render target
+	OUTLINE_RESOLUTION = 8192,   // Maximum vertical resolution of the render target
+	TILE_SIZE_LOG2 = 6,          // 64x64 pixel tiles for binned rasterization
+	BLOCK_SIZE_LOG2 = 3,         // 8x8 pixel blocks for half-space rasterization
 	MIPMAP_LEVELS = 14,
 	MAX_COLOR_ATTACHMENTS = 8,
 	VERTEX_ATTRIBUTES = 16,
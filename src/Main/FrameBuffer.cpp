@@ -198,7 +198,14 @@ namespace sw
 			blitFunction = (void(*)(void*, void*))blitRoutine->getEntry();
 		}
 
+		int64_t startTick = optimizationProfiling ? Timer::ticks() : 0;
+
 		blitFunction(locked, target);
+
+		if(optimizationProfiling)
+		{
+			addRoutineExecution(RoutineFrameBuffer, Timer::ticks() - startTick);
+		}
 	}
 
 	Routine *FrameBuffer::copyRoutine(const BlitState &state)
@@ -229,7 +236,7 @@ namespace sw
 
 		int date = (year << 16) + (month << 8) + day;
 
-		Function<Void, Pointer<Byte>, Pointer<Byte> > function;
+		Function<Void, Pointer<Byte>, Pointer<Byte> > function(RoutineFrameBuffer);
 		{
 			Pointer<Byte> dst(function.arg(0));
 			Pointer<Byte> src(function.arg(1));
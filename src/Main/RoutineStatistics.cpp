@@ -0,0 +1,65 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+
+#include "RoutineStatistics.h"
+
+#include "Timer.hpp"
+#include "Reactor/Nucleus.hpp"
+#include "Renderer/RoutineCache.hpp"
+#include "Renderer/VertexProcessor.hpp"
+#include "Renderer/SetupProcessor.hpp"
+#include "Renderer/PixelProcessor.hpp"
+#include "Renderer/Sampler.hpp"
+
+#include <string.h>
+
+namespace sw
+{
+	template<class State>
+	static void getCacheStatistics(swRoutineCacheStatistics &statistics)
+	{
+		statistics.hits = RoutineCache<State>::getHits();
+		statistics.misses = RoutineCache<State>::getMisses();
+	}
+}
+
+using namespace sw;
+
+extern "C"
+{
+	void swGetRoutineStatistics(swRoutineStatistics *statistics, unsigned int size)
+	{
+		if(!statistics)
+		{
+			return;
+		}
+
+		CompileStatistics compile;
+		getCompileStatistics(compile);
+
+		swRoutineStatistics current;
+		current.routines = compile.routines;
+		current.optimizedRoutines = compile.optimizedRoutines;
+		current.compileSeconds = (double)compile.compileTime / Timer::frequency();
+		current.maxCompileSeconds = (double)compile.maxCompileTime / Timer::frequency();
+		current.instructionsBefore = compile.instructionsBefore;
+		current.instructionsAfter = compile.instructionsAfter;
+		current.codeBytes = compile.codeBytes;
+		current.cachedCodeBytes = routineCacheMemory;
+		getCacheStatistics<VertexProcessor::State>(current.vertexCache);
+		getCacheStatistics<SetupProcessor::State>(current.setupCache);
+		getCacheStatistics<PixelProcessor::State>(current.pixelCache);
+		getCacheStatistics<Sampler::RoutineState>(current.samplerCache);
+
+		memcpy(statistics, &current, size < sizeof(current) ? size : sizeof(current));
+	}
+}
@@ -0,0 +1,53 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+
+#ifndef sw_RoutineStatistics_h
+#define sw_RoutineStatistics_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Lookups in the routine caches for one type of routine. The counters wrap around,
+// so monitoring should use the difference between two samples.
+typedef struct swRoutineCacheStatistics
+{
+	unsigned int hits;
+	unsigned int misses;
+} swRoutineCacheStatistics;
+
+// Totals since the library was loaded
+typedef struct swRoutineStatistics
+{
+	unsigned long long routines;             // Generated, including unoptimized ones
+	unsigned long long optimizedRoutines;
+	double compileSeconds;                   // Wall time from the start of generation until the code is emitted
+	double maxCompileSeconds;                // Of the slowest routine
+	unsigned long long instructionsBefore;   // IR instructions before and after optimization
+	unsigned long long instructionsAfter;
+	unsigned long long codeBytes;            // Machine code generated, excluding constants
+	unsigned long long cachedCodeBytes;      // Currently held by the routine caches
+	swRoutineCacheStatistics vertexCache;
+	swRoutineCacheStatistics setupCache;
+	swRoutineCacheStatistics pixelCache;
+	swRoutineCacheStatistics samplerCache;
+} swRoutineStatistics;
+
+// Fills the first size bytes of the statistics, so callers built against an older version of this structure keep working
+void swGetRoutineStatistics(swRoutineStatistics *statistics, unsigned int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // sw_RoutineStatistics_h
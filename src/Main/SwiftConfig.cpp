@@ -15,6 +15,9 @@
 #include "Debug.hpp"
 #include "Config.hpp"
 #include "Version.h"
+#include "Timer.hpp"
+#include "RoutineStatistics.h"
+#include "Reactor/CodeHeap.hpp"
 
 #include <sstream>
 #include <stdio.h>
@@ -33,6 +36,13 @@ namespace sw
 		return ss.str();
 	}
 	
+	std::string utoa(unsigned long long number)
+	{
+		std::stringstream ss;
+		ss << number;
+		return ss.str();
+	}
+
 	std::string ftoa(double number)
 	{
 		std::stringstream ss;
@@ -40,6 +50,22 @@ namespace sw
 		return ss.str();
 	}
 
+	static const char *routineTypeName[RoutineTypeCount] = {"Vertex", "Setup", "Pixel", "Blit", "FrameBuffer", "Sampler"};
+
+	static const char *optimizationName[OptimizationCount] =
+	{
+		"Disabled",
+		"Instruction Combining",
+		"Control Flow Simplification",
+		"Loop Invariant Code Motion",
+		"Aggressive Dead Code Elimination",
+		"Global Value Numbering",
+		"Commutative Expressions Reassociation",
+		"Dead Store Elimination",
+		"Sparse Conditional Copy Propagation",
+		"Scalar Replacement of Aggregates"
+	};
+
 	SwiftConfig::SwiftConfig(bool disableServerOverride) : listenSocket(0)
 	{
 		readConfiguration(disableServerOverride);
@@ -330,6 +356,16 @@ namespace sw
 		html += "<option value='4096'" + (config.setupRoutineCacheSize == 4096 ? selected : empty) + ">4096</option>\n";
 		html += "</select></td>\n";
 		html += "</tr>\n";
+		html += "<tr><td>Routine cache memory:</td><td><select name='routineCacheMemory' title='The amount of memory (in MB) all routine caches together may use for generated code. Least recently used routines are evicted to stay within this limit.'>\n";
+		html += "<option value='0'"    + (config.routineCacheMemory == 0    ? selected : empty) + ">Unlimited</option>\n";
+		html += "<option value='32'"   + (config.routineCacheMemory == 32   ? selected : empty) + ">32</option>\n";
+		html += "<option value='64'"   + (config.routineCacheMemory == 64   ? selected : empty) + ">64</option>\n";
+		html += "<option value='128'"  + (config.routineCacheMemory == 128  ? selected : empty) + ">128</option>\n";
+		html += "<option value='256'"  + (config.routineCacheMemory == 256  ? selected : empty) + ">256 (default)</option>\n";
+		html += "<option value='512'"  + (config.routineCacheMemory == 512  ? selected : empty) + ">512</option>\n";
+		html += "</select></td>\n";
+		html += "</tr>\n";
+		html += "<tr><td>Shared routine caches:</td><td><input name = 'sharedRoutineCache' type='checkbox'" + (config.sharedRoutineCache ? checked : empty) + " title='If checked all renderers in the process share their routine caches, instead of each context generating its own copies.'></td></tr>";
 		html += "<tr><td>Vertex cache size:</td><td><select name='vertexCacheSize' title='The number of processed vertices being cached for reuse. Lower numbers save memory but require more vertices to be reprocessed.'>\n";
 		html += "<option value='64'"   + (config.vertexCacheSize == 64   ? selected : empty) + ">64 (default)</option>\n";
 		html += "</select></td>\n";
@@ -388,6 +424,17 @@ namespace sw
 		html += "<option value='15'" + (config.threadCount == 15 ? selected : empty) + ">15</option>\n";
 		html += "<option value='16'" + (config.threadCount == 16 ? selected : empty) + ">16</option>\n";
 		html += "</select></td></tr>\n";
+		html += "<tr><td>Buffered draw calls:</td><td><select name='drawCallCount' title='The number of draw calls which can be queued before the application has to wait for the rendering threads.'>\n";
+		html += "<option value='0'"   + (config.drawCallCount == 0   ? selected : empty) + ">Twice the thread count, at least 16 (default)</option>\n";
+		html += "<option value='4'"   + (config.drawCallCount == 4   ? selected : empty) + ">4</option>\n";
+		html += "<option value='8'"   + (config.drawCallCount == 8   ? selected : empty) + ">8</option>\n";
+		html += "<option value='16'"  + (config.drawCallCount == 16  ? selected : empty) + ">16</option>\n";
+		html += "<option value='32'"  + (config.drawCallCount == 32  ? selected : empty) + ">32</option>\n";
+		html += "<option value='64'"  + (config.drawCallCount == 64  ? selected : empty) + ">64</option>\n";
+		html += "<option value='128'" + (config.drawCallCount == 128 ? selected : empty) + ">128</option>\n";
+		html += "</select></td></tr>\n";
+		html += "<tr><td>Tiled rasterization (experimental):</td><td><input name = 'tiledRasterization' type='checkbox'" + (config.tiledRasterization ? checked : empty) + " title='Experimental, usually slower than the default. If checked primitives are binned to screen tiles, and each thread renders its own tiles instead of interleaved scanlines.'></td></tr>";
+		html += "<tr><td>Half-space rasterization:</td><td><input name = 'halfSpaceRasterization' type='checkbox'" + (config.halfSpaceRasterization ? checked : empty) + " title='If checked tiles are rasterized by evaluating edge functions on 8x8 pixel blocks. Implies tiled rasterization.'></td></tr>";
 		html += "<tr><td>Enable SSE:</td><td><input name = 'enableSSE' type='checkbox'" + (config.enableSSE ? checked : empty) + " disabled='disabled' title='If checked enables the use of SSE instruction set extentions if supported by the CPU.'></td></tr>";
 		html += "<tr><td>Enable SSE2:</td><td><input name = 'enableSSE2' type='checkbox'" + (config.enableSSE2 ? checked : empty) + " title='If checked enables the use of SSE2 instruction set extentions if supported by the CPU.'></td></tr>";
 		html += "<tr><td>Enable SSE3:</td><td><input name = 'enableSSE3' type='checkbox'" + (config.enableSSE3 ? checked : empty) + " title='If checked enables the use of SSE3 instruction set extentions if supported by the CPU.'></td></tr>";
@@ -397,22 +444,38 @@ namespace sw
 		html += "<h2><em>Compiler optimizations</em></h2>\n";
 		html += "<table>\n";
 
+		html += "<tr><td></td>";
+
+		for(int type = 0; type < RoutineTypeCount; type++)
+		{
+			html += "<td>" + std::string(routineTypeName[type]) + " routines</td>";
+		}
+
+		html += "</tr>\n";
+
 		for(int pass = 0; pass < 10; pass++)
 		{
-			html += "<tr><td>Optimization pass " + itoa(pass + 1) + ":</td><td><select name='optimization" + itoa(pass + 1) + "' title='An optimization pass for the shader compiler.'>\n";
-			html += "<option value='0'"  + (config.optimization[pass] == 0  ? selected : empty) + ">Disabled" + (pass > 0 ? " (default)" : "") + "</option>\n";
-			html += "<option value='1'"  + (config.optimization[pass] == 1  ? selected : empty) + ">Instruction Combining" + (pass == 0 ? " (default)" : "") + "</option>\n";
-			html += "<option value='2'"  + (config.optimization[pass] == 2  ? selected : empty) + ">Control Flow Simplification</option>\n";
-			html += "<option value='3'"  + (config.optimization[pass] == 3  ? selected : empty) + ">Loop Invariant Code Motion</option>\n";
-			html += "<option value='4'"  + (config.optimization[pass] == 4  ? selected : empty) + ">Aggressive Dead Code Elimination</option>\n";
-			html += "<option value='5'"  + (config.optimization[pass] == 5  ? selected : empty) + ">Global Value Numbering</option>\n";
-			html += "<option value='6'"  + (config.optimization[pass] == 6  ? selected : empty) + ">Commutative Expressions Reassociation</option>\n";
-			html += "<option value='7'"  + (config.optimization[pass] == 7  ? selected : empty) + ">Dead Store Elimination</option>\n";
-			html += "<option value='8'"  + (config.optimization[pass] == 8  ? selected : empty) + ">Sparse Conditional Copy Propagation</option>\n";
-			html += "<option value='9'"  + (config.optimization[pass] == 9  ? selected : empty) + ">Scalar Replacement of Aggregates</option>\n";
-			html += "</select></td></tr>\n";
+			html += "<tr><td>Optimization pass " + itoa(pass + 1) + ":</td>";
+
+			for(int type = 0; type < RoutineTypeCount; type++)
+			{
+				html += "<td><select name='optimization" + itoa(type) + "_" + itoa(pass + 1) + "' title='An optimization pass for the compiler of this type of routine.'>\n";
+
+				for(int option = 0; option < OptimizationCount; option++)
+				{
+					bool isDefault = (pass == 0) ? (option == InstructionCombining) : (option == Disabled);
+
+					html += "<option value='" + itoa(option) + "'" + (config.optimization[type][pass] == option ? selected : empty) + ">" + optimizationName[option] + (isDefault ? " (default)" : "") + "</option>\n";
+				}
+
+				html += "</select></td>";
+			}
+
+			html += "</tr>\n";
 		}
 
+		html += "<tr><td>Profile optimizations:</td><td><input name = 'optimizationProfiling' type='checkbox'" + (config.optimizationProfiling == true ? checked : empty) + " title='If checked the compile time of each optimization pass and the execution time of each type of routine are shown in the profile.'></td></tr>";
+		html += "<tr><td>Profile pipeline stages:</td><td><input name = 'pipelineProfiling' type='checkbox'" + (config.pipelineProfiling == true ? checked : empty) + " title='If checked routines get regenerated to count the cycles spent in each pixel pipeline stage and the raster and texture operations, which are shown in the profile.'></td></tr>";
 		html += "</table>\n";
 		html += "<h2><em>Testing & Experimental</em></h2>\n";
 		html += "<table>\n";
@@ -427,7 +490,15 @@ namespace sw
 		html += "<option value='0'" + (config.frameBufferAPI == 0 ? selected : empty) + ">DirectDraw (default)</option>\n";
 		html += "<option value='1'" + (config.frameBufferAPI == 1 ? selected : empty) + ">GDI</option>\n";
 		html += "</select></td>\n";
-		html += "<tr><td>DLL precaching:</td><td><input name = 'precache' type='checkbox'" + (config.precache == true ? checked : empty) + " title='If checked dynamically generated routines will be stored in a DLL for faster loading on application restart.'></td></tr>";
+		html += "<tr><td>Routine precaching:</td><td><input name = 'precache' type='checkbox'" + (config.precache == true ? checked : empty) + " title='If checked dynamically generated routines will be stored in a DLL (Windows) or cache file (Linux) for faster loading on application restart.'></td></tr>";
+		html += "<tr><td>Background compilation:</td><td><input name = 'backgroundCompilation' type='checkbox'" + (config.backgroundCompilation == true ? checked : empty) + " title='If checked new routines are first compiled without optimizations, and replaced by optimized routines compiled on a background thread once they are frequently used.'></td></tr>";
+		html += "<tr><td>Recompile threshold:</td><td><select name='recompileThreshold' title='The number of draw calls using an unoptimized routine after which it gets recompiled with optimizations in the background.'>\n";
+		html += "<option value='1'"   + (config.recompileThreshold == 1   ? selected : empty) + ">1</option>\n";
+		html += "<option value='4'"   + (config.recompileThreshold == 4   ? selected : empty) + ">4</option>\n";
+		html += "<option value='16'"  + (config.recompileThreshold == 16  ? selected : empty) + ">16 (default)</option>\n";
+		html += "<option value='64'"  + (config.recompileThreshold == 64  ? selected : empty) + ">64</option>\n";
+		html += "<option value='256'" + (config.recompileThreshold == 256 ? selected : empty) + ">256</option>\n";
+		html += "</select></td>\n";
 		html += "<tr><td>Shadow mapping extensions:</td><td><select name='shadowMapping' title='Features that may accelerate or improve the quality of shadow mapping.'>\n";
 		html += "<option value='0'" + (config.shadowMapping == 0 ? selected : empty) + ">None</option>\n";
 		html += "<option value='1'" + (config.shadowMapping == 1 ? selected : empty) + ">Fetch4</option>\n";
@@ -452,6 +523,7 @@ namespace sw
 		html += "</html>\n";
 
 		profiler.reset();
+		resetOptimizationStatistics();
 
 		return html;
 	}
@@ -462,8 +534,56 @@ namespace sw
 
 		html += "<p>FPS: " + ftoa(profiler.FPS) + "</p>\n";
 		html += "<p>Frame: " + itoa(profiler.framesTotal) + "</p>\n";
+		html += "<p>Draws using unoptimized pixel routines: " + itoa(profiler.unoptimizedDraws) + "</p>\n";
+
+		CodeHeap::Statistics codeHeap;
+		CodeHeap::getStatistics(codeHeap);
+		size_t freeBytes = codeHeap.slabBytes - codeHeap.codeBytes;
+		int fragmentation = freeBytes ? (int)(100 - 100 * codeHeap.largestFreeBytes / freeBytes) : 0;
+
+		html += "<p>Routine code: " + itoa((int)(codeHeap.codeBytes >> 10)) + " kB in " + itoa(codeHeap.slabCount) + " slabs of " + itoa((int)(codeHeap.slabBytes >> 10)) + " kB, " + itoa(fragmentation) + "% of free space fragmented</p>\n";
+
+		swRoutineStatistics routines;
+		swGetRoutineStatistics(&routines, sizeof(routines));
+		double averageRoutines = (double)std::max(routines.routines, 1ULL);
+
+		html += "<p>Routines compiled: " + utoa(routines.routines) + " (" + utoa(routines.optimizedRoutines) + " optimized), " + ftoa(routines.compileSeconds) + " s in total, " + ftoa(1000 * routines.compileSeconds / averageRoutines) + " ms on average, " + ftoa(1000 * routines.maxCompileSeconds) + " ms at most</p>\n";
+		html += "<p>Instructions per routine: " + ftoa(routines.instructionsBefore / averageRoutines) + " before optimization, " + ftoa(routines.instructionsAfter / averageRoutines) + " after, " + ftoa(routines.codeBytes / averageRoutines) + " bytes of machine code</p>\n";
+		html += "<p>Routine cache hits / misses: " + utoa(routines.vertexCache.hits) + " / " + utoa(routines.vertexCache.misses) + " (vertex), " + utoa(routines.setupCache.hits) + " / " + utoa(routines.setupCache.misses) + " (setup), " + utoa(routines.pixelCache.hits) + " / " + utoa(routines.pixelCache.misses) + " (pixel), " + utoa(routines.samplerCache.hits) + " / " + utoa(routines.samplerCache.misses) + " (sampler)</p>\n";
+
+		if(config.optimizationProfiling)
+		{
+			double milliseconds = 1000.0 / Timer::frequency();
+
+			html += "<table>\n";
+			html += "<tr><td>Routine type</td><td>Optimized routines</td><td>Average pass time (ms)</td><td>Average code generation time (ms)</td><td>Executions</td><td>Average execution time (kcycles)</td></tr>\n";
+
+			for(int type = 0; type < RoutineTypeCount; type++)
+			{
+				OptimizationStatistics statistics;
+				getOptimizationStatistics((RoutineType)type, statistics);
 
-		#if PERF_PROFILE
+				int routines = std::max(statistics.routines, 1);
+				std::string passes;
+
+				for(int pass = 0; pass < 10 && config.optimization[type][pass] != Disabled; pass++)
+				{
+					passes += std::string(pass > 0 ? "<br>" : "") + optimizationName[config.optimization[type][pass]] + ": " + ftoa(statistics.passTime[pass] * milliseconds / routines);
+				}
+
+				html += "<tr><td>" + std::string(routineTypeName[type]) + "</td>";
+				html += "<td>" + itoa(statistics.routines) + "</td>";
+				html += "<td>" + passes + "</td>";
+				html += "<td>" + ftoa(statistics.codeGenerationTime * milliseconds / routines) + "</td>";
+				html += "<td>" + utoa(statistics.executions) + "</td>";
+				html += "<td>" + ftoa(statistics.executionTicks / 1000.0 / std::max(statistics.executions, (int64_t)1)) + "</td></tr>\n";
+			}
+
+			html += "</table>\n";
+		}
+
+		if(config.pipelineProfiling && profiler.cycles[PERF_PIXEL] > 0)
+		{
 			int texTime = (int)(1000 * profiler.cycles[PERF_TEX] / profiler.cycles[PERF_PIXEL] + 0.5);
 			int shaderTime = (int)(1000 * profiler.cycles[PERF_SHADER] / profiler.cycles[PERF_PIXEL] + 0.5);
 			int pipeTime = (int)(1000 * profiler.cycles[PERF_PIPE] / profiler.cycles[PERF_PIXEL] + 0.5);
@@ -502,7 +622,7 @@ namespace sw
 			{
 				profiler.cycles[i] = 0;
 			}
-		#endif
+		}
 
 		return html;
 	}
@@ -535,6 +655,8 @@ namespace sw
 		config.enableSSE3 = false;
 		config.enableSSSE3 = false;
 		config.enableSSE4_1 = false;
+		config.tiledRasterization = false;
+		config.halfSpaceRasterization = false;
 		config.disableServer = false;
 		config.forceWindowed = false;
 		config.complementaryDepthBuffer = false;
@@ -542,13 +664,18 @@ namespace sw
 		config.exactColorRounding = false;
 		config.disableAlphaMode = false;
 		config.disable10BitMode = false;
+		config.sharedRoutineCache = false;
 		config.precache = false;
+		config.backgroundCompilation = false;
 		config.forceClearRegisters = false;
+		config.optimizationProfiling = false;
+		config.pipelineProfiling = false;
 
 		while(*post != 0)
 		{
 			int integer;
 			int index;
+			int type;
 
 			if(sscanf(post, "pixelShaderVersion=%d", &integer))
 			{
@@ -578,6 +705,14 @@ namespace sw
 			{
 				config.setupRoutineCacheSize = integer;
 			}
+			else if(sscanf(post, "routineCacheMemory=%d", &integer))
+			{
+				config.routineCacheMemory = integer;
+			}
+			else if(strstr(post, "sharedRoutineCache=on"))
+			{
+				config.sharedRoutineCache = true;
+			}
 			else if(sscanf(post, "vertexCacheSize=%d", &integer))
 			{
 				config.vertexCacheSize = integer;
@@ -606,6 +741,14 @@ namespace sw
 			{
 				config.threadCount = integer;
 			}
+			else if(sscanf(post, "drawCallCount=%d", &integer))
+			{
+				config.drawCallCount = integer;
+			}
+			else if(sscanf(post, "recompileThreshold=%d", &integer))
+			{
+				config.recompileThreshold = integer;
+			}
 			else if(sscanf(post, "frameBufferAPI=%d", &integer))
 			{
 				config.frameBufferAPI = integer;
@@ -646,9 +789,25 @@ namespace sw
 					config.enableSSE4_1 = true;
 				}
 			}
-			else if(sscanf(post, "optimization%d=%d", &index, &integer))
+			else if(strstr(post, "tiledRasterization=on"))
 			{
-				config.optimization[index - 1] = (Optimization)integer;
+				config.tiledRasterization = true;
+			}
+			else if(strstr(post, "halfSpaceRasterization=on"))
+			{
+				config.halfSpaceRasterization = true;
+			}
+			else if(sscanf(post, "optimization%d_%d=%d", &type, &index, &integer) == 3)
+			{
+				config.optimization[type][index - 1] = (Optimization)integer;
+			}
+			else if(strstr(post, "optimizationProfiling=on"))
+			{
+				config.optimizationProfiling = true;
+			}
+			else if(strstr(post, "pipelineProfiling=on"))
+			{
+				config.pipelineProfiling = true;
 			}
 			else if(strstr(post, "disableServer=on"))
 			{
@@ -682,6 +841,10 @@ namespace sw
 			{
 				config.precache = true;
 			}
+			else if(strstr(post, "backgroundCompilation=on"))
+			{
+				config.backgroundCompilation = true;
+			}
 			else if(strstr(post, "forceClearRegisters=on"))
 			{
 				config.forceClearRegisters = true;
@@ -720,6 +883,8 @@ namespace sw
 		config.vertexRoutineCacheSize = ini.getInteger("Caches", "VertexRoutineCacheSize", 1024);
 		config.pixelRoutineCacheSize = ini.getInteger("Caches", "PixelRoutineCacheSize", 1024);
 		config.setupRoutineCacheSize = ini.getInteger("Caches", "SetupRoutineCacheSize", 1024);
+		config.routineCacheMemory = ini.getInteger("Caches", "RoutineCacheMemory", 256);
+		config.sharedRoutineCache = ini.getBoolean("Caches", "SharedRoutineCache", true);
 		config.vertexCacheSize = ini.getInteger("Caches", "VertexCacheSize", 64);
 		config.textureSampleQuality = ini.getInteger("Quality", "TextureSampleQuality", 2);
 		config.mipmapQuality = ini.getInteger("Quality", "MipmapQuality", 1);
@@ -727,6 +892,9 @@ namespace sw
 		config.transcendentalPrecision = ini.getInteger("Quality", "TranscendentalPrecision", 2);
 		config.transparencyAntialiasing = ini.getInteger("Quality", "TransparencyAntialiasing", 0);
 		config.threadCount = ini.getInteger("Processor", "ThreadCount", 1);
+		config.drawCallCount = ini.getInteger("Processor", "DrawCallCount", 0);
+		config.tiledRasterization = ini.getBoolean("Processor", "TiledRasterization", false);
+		config.halfSpaceRasterization = ini.getBoolean("Processor", "HalfSpaceRasterization", false);
 		config.enableSSE = ini.getBoolean("Processor", "EnableSSE", true);
 		config.enableSSE2 = ini.getBoolean("Processor", "EnableSSE2", true);
 		config.enableSSE3 = ini.getBoolean("Processor", "EnableSSE3", true);
@@ -735,9 +903,18 @@ namespace sw
 
 		for(int pass = 0; pass < 10; pass++)
 		{
-			config.optimization[pass] = (Optimization)ini.getInteger("Optimization", "OptimizationPass" + itoa(pass + 1), pass == 0 ? InstructionCombining : Disabled);
+			// The common list of earlier versions is the default for each type of routine
+			int common = ini.getInteger("Optimization", "OptimizationPass" + itoa(pass + 1), pass == 0 ? InstructionCombining : Disabled);
+
+			for(int type = 0; type < RoutineTypeCount; type++)
+			{
+				config.optimization[type][pass] = (Optimization)ini.getInteger("Optimization", routineTypeName[type] + std::string("Pass") + itoa(pass + 1), common);
+			}
 		}
 
+		config.optimizationProfiling = ini.getBoolean("Optimization", "Profiling", false);
+		config.pipelineProfiling = ini.getBoolean("Optimization", "PipelineProfiling", false);
+
 		config.disableServer = ini.getBoolean("Testing", "DisableServer", false);
 		config.forceWindowed = ini.getBoolean("Testing", "ForceWindowed", false);
 		config.complementaryDepthBuffer = ini.getBoolean("Testing", "ComplementaryDepthBuffer", false);
@@ -747,6 +924,8 @@ namespace sw
 		config.disable10BitMode = ini.getBoolean("Testing", "Disable10BitMode", false);
 		config.frameBufferAPI = ini.getInteger("Testing", "FrameBufferAPI", 0);
 		config.precache = ini.getBoolean("Testing", "Precache", false);
+		config.backgroundCompilation = ini.getBoolean("Testing", "BackgroundCompilation", false);
+		config.recompileThreshold = ini.getInteger("Testing", "RecompileThreshold", 16);
 		config.shadowMapping = ini.getInteger("Testing", "ShadowMapping", 3);
 		config.forceClearRegisters = ini.getBoolean("Testing", "ForceClearRegisters", false);
 
@@ -778,6 +957,8 @@ namespace sw
 		ini.addValue("Caches", "VertexRoutineCacheSize", itoa(config.vertexRoutineCacheSize));
 		ini.addValue("Caches", "PixelRoutineCacheSize", itoa(config.pixelRoutineCacheSize));
 		ini.addValue("Caches", "SetupRoutineCacheSize", itoa(config.setupRoutineCacheSize));
+		ini.addValue("Caches", "RoutineCacheMemory", itoa(config.routineCacheMemory));
+		ini.addValue("Caches", "SharedRoutineCache", itoa(config.sharedRoutineCache));
 		ini.addValue("Caches", "VertexCacheSize", itoa(config.vertexCacheSize));
 		ini.addValue("Quality", "TextureSampleQuality", itoa(config.textureSampleQuality));
 		ini.addValue("Quality", "MipmapQuality", itoa(config.mipmapQuality));
@@ -785,17 +966,26 @@ namespace sw
 		ini.addValue("Quality", "TranscendentalPrecision", itoa(config.transcendentalPrecision));
 		ini.addValue("Quality", "TransparencyAntialiasing", itoa(config.transparencyAntialiasing));
 		ini.addValue("Processor", "ThreadCount", itoa(config.threadCount));
+		ini.addValue("Processor", "DrawCallCount", itoa(config.drawCallCount));
+		ini.addValue("Processor", "TiledRasterization", itoa(config.tiledRasterization));
+		ini.addValue("Processor", "HalfSpaceRasterization", itoa(config.halfSpaceRasterization));
 	//	ini.addValue("Processor", "EnableSSE", itoa(config.enableSSE));
 		ini.addValue("Processor", "EnableSSE2", itoa(config.enableSSE2));
 		ini.addValue("Processor", "EnableSSE3", itoa(config.enableSSE3));
 		ini.addValue("Processor", "EnableSSSE3", itoa(config.enableSSSE3));
 		ini.addValue("Processor", "EnableSSE4_1", itoa(config.enableSSE4_1));
 
-		for(int pass = 0; pass < 10; pass++)
+		for(int type = 0; type < RoutineTypeCount; type++)
 		{
-			ini.addValue("Optimization", "OptimizationPass" + itoa(pass + 1), itoa(config.optimization[pass]));
+			for(int pass = 0; pass < 10; pass++)
+			{
+				ini.addValue("Optimization", routineTypeName[type] + std::string("Pass") + itoa(pass + 1), itoa(config.optimization[type][pass]));
+			}
 		}
 
+		ini.addValue("Optimization", "Profiling", itoa(config.optimizationProfiling));
+		ini.addValue("Optimization", "PipelineProfiling", itoa(config.pipelineProfiling));
+
 		ini.addValue("Testing", "DisableServer", itoa(config.disableServer));
 		ini.addValue("Testing", "ForceWindowed", itoa(config.forceWindowed));
 		ini.addValue("Testing", "ComplementaryDepthBuffer", itoa(config.complementaryDepthBuffer));
@@ -805,6 +995,8 @@ namespace sw
 		ini.addValue("Testing", "Disable10BitMode", itoa(config.disable10BitMode));
 		ini.addValue("Testing", "FrameBufferAPI", itoa(config.frameBufferAPI));
 		ini.addValue("Testing", "Precache", itoa(config.precache));
+		ini.addValue("Testing", "BackgroundCompilation", itoa(config.backgroundCompilation));
+		ini.addValue("Testing", "RecompileThreshold", itoa(config.recompileThreshold));
 		ini.addValue("Testing", "ShadowMapping", itoa(config.shadowMapping));
 		ini.addValue("Testing", "ForceClearRegisters", itoa(config.forceClearRegisters));
 		ini.addValue("LastModified", "Time", itoa((int)time(0)));
@@ -34,18 +34,25 @@ namespace sw
 			int vertexRoutineCacheSize;
 			int pixelRoutineCacheSize;
 			int setupRoutineCacheSize;
+			int routineCacheMemory;
+			bool sharedRoutineCache;
 			int vertexCacheSize;
 			int textureSampleQuality;
 			int mipmapQuality;
 			bool perspectiveCorrection;
 			int transcendentalPrecision;
 			int threadCount;
+			int drawCallCount;
+			bool tiledRasterization;
+			bool halfSpaceRasterization;
 			bool enableSSE;
 			bool enableSSE2;
 			bool enableSSE3;
 			bool enableSSSE3;
 			bool enableSSE4_1;
-			Optimization optimization[10];
+			Optimization optimization[RoutineTypeCount][10];
+			bool optimizationProfiling;
+			bool pipelineProfiling;
 			bool disableServer;
 			bool keepSystemCursor;
 			bool forceWindowed;
@@ -57,6 +64,8 @@ namespace sw
 			int transparencyAntialiasing;
 			int frameBufferAPI;
 			bool precache;
+			bool backgroundCompilation;
+			int recompileThreshold;
 			int shadowMapping;
 			bool forceClearRegisters;
 		#ifndef NDEBUG
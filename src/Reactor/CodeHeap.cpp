@@ -0,0 +1,193 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+#include "CodeHeap.hpp"
+
+#include "../Common/Memory.hpp"
+#include "../Common/Math.hpp"
+#include "../Common/Debug.hpp"
+
+namespace sw
+{
+	static const size_t blockSize = 64;    // Cache line, entry points stay aligned
+	static const int slabBlocks = 16384;   // 1 MB
+
+	std::vector<CodeHeap::Slab*> CodeHeap::slabs;
+	BackoffLock CodeHeap::mutex;
+
+	void *CodeHeap::allocate(size_t bytes)
+	{
+		int count = blocks(bytes);
+
+		mutex.lock();
+
+		for(size_t s = 0; s < slabs.size(); s++)
+		{
+			Slab *slab = slabs[s];
+
+			if(slab->blockCount - slab->usedBlocks < count)
+			{
+				continue;
+			}
+
+			// First fit, to keep the code compact
+			for(int i = 0, run = 0; i < slab->blockCount; i++)
+			{
+				run = slab->used[i] ? 0 : run + 1;
+
+				if(run == count)
+				{
+					int first = i - count + 1;
+
+					for(int j = first; j <= i; j++)
+					{
+						slab->used[j] = true;
+					}
+
+					slab->usedBlocks += count;
+
+					mutex.unlock();
+
+					return slab->memory + first * blockSize;
+				}
+			}
+		}
+
+		Slab *slab = new Slab();
+		slab->blockCount = max(count, slabBlocks);
+		slab->usedBlocks = count;
+		slab->memory = (unsigned char*)allocateExecutable(slab->blockCount * blockSize);
+		slab->used.resize(slab->blockCount, false);
+
+		// Routines get written next to running ones, so the protection is set once for the whole slab
+		markWritableExecutable(slab->memory, slab->blockCount * blockSize);
+
+		for(int i = 0; i < count; i++)
+		{
+			slab->used[i] = true;
+		}
+
+		slabs.push_back(slab);
+
+		mutex.unlock();
+
+		return slab->memory;
+	}
+
+	void CodeHeap::shrink(void *memory, size_t bytes, size_t newBytes)
+	{
+		int count = blocks(bytes);
+		int newCount = max(blocks(newBytes), 1);
+
+		if(newCount >= count)
+		{
+			return;
+		}
+
+		mutex.lock();
+
+		Slab *slab = findSlab(memory);
+		int first = (int)(((unsigned char*)memory - slab->memory) / blockSize);
+		release(slab, first + newCount, count - newCount);
+
+		mutex.unlock();
+	}
+
+	void CodeHeap::deallocate(void *memory, size_t bytes)
+	{
+		if(!memory)
+		{
+			return;
+		}
+
+		int count = blocks(bytes);
+
+		mutex.lock();
+
+		Slab *slab = findSlab(memory);
+		int first = (int)(((unsigned char*)memory - slab->memory) / blockSize);
+		release(slab, first, count);
+
+		if(slab->usedBlocks == 0 && slabs.size() > 1)   // Keep the last slab, to not reallocate it for every routine
+		{
+			for(size_t s = 0; s < slabs.size(); s++)
+			{
+				if(slabs[s] == slab)
+				{
+					slabs.erase(slabs.begin() + s);
+					break;
+				}
+			}
+
+			deallocateExecutable(slab->memory, slab->blockCount * blockSize);
+			delete slab;
+		}
+
+		mutex.unlock();
+	}
+
+	void CodeHeap::getStatistics(Statistics &statistics)
+	{
+		statistics.slabCount = 0;
+		statistics.slabBytes = 0;
+		statistics.codeBytes = 0;
+		statistics.largestFreeBytes = 0;
+
+		mutex.lock();
+
+		for(size_t s = 0; s < slabs.size(); s++)
+		{
+			const Slab *slab = slabs[s];
+
+			statistics.slabCount++;
+			statistics.slabBytes += slab->blockCount * blockSize;
+			statistics.codeBytes += slab->usedBlocks * blockSize;
+
+			for(int i = 0, run = 0; i < slab->blockCount; i++)
+			{
+				run = slab->used[i] ? 0 : run + 1;
+				statistics.largestFreeBytes = max(statistics.largestFreeBytes, run * blockSize);
+			}
+		}
+
+		mutex.unlock();
+	}
+
+	int CodeHeap::blocks(size_t bytes)
+	{
+		return (int)((bytes + blockSize - 1) / blockSize);
+	}
+
+	CodeHeap::Slab *CodeHeap::findSlab(void *memory)
+	{
+		for(size_t s = 0; s < slabs.size(); s++)
+		{
+			if(memory >= slabs[s]->memory && memory < slabs[s]->memory + slabs[s]->blockCount * blockSize)
+			{
+				return slabs[s];
+			}
+		}
+
+		ASSERT(false);
+		return 0;
+	}
+
+	void CodeHeap::release(Slab *slab, int first, int count)
+	{
+		for(int i = first; i < first + count; i++)
+		{
+			ASSERT(slab->used[i]);
+			slab->used[i] = false;
+		}
+
+		slab->usedBlocks -= count;
+	}
+}
@@ -0,0 +1,60 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+#ifndef sw_CodeHeap_hpp
+#define sw_CodeHeap_hpp
+
+#include "../Common/MutexLock.hpp"
+
+#include <vector>
+#include <stddef.h>
+
+namespace sw
+{
+	// Packs routines into large slabs instead of allocating memory for each of them. Allocations
+	// are cache line granular, so small routines share pages. Slabs are made writable and executable
+	// once when they're allocated, instead of changing the protection for each routine.
+	class CodeHeap
+	{
+	public:
+		static void *allocate(size_t bytes);   // Writable and executable
+		static void shrink(void *memory, size_t bytes, size_t newBytes);   // Releases the blocks past newBytes
+		static void deallocate(void *memory, size_t bytes);
+
+		struct Statistics
+		{
+			int slabCount;
+			size_t slabBytes;   // Reserved for code
+			size_t codeBytes;   // Allocated to routines
+			size_t largestFreeBytes;
+		};
+
+		static void getStatistics(Statistics &statistics);
+
+	private:
+		struct Slab
+		{
+			unsigned char *memory;
+			int blockCount;
+			int usedBlocks;
+			std::vector<bool> used;
+		};
+
+		static int blocks(size_t bytes);
+		static Slab *findSlab(void *memory);
+		static void release(Slab *slab, int first, int count);
+
+		static std::vector<Slab*> slabs;   // In allocation order, so code gets packed into the oldest slabs
+		static BackoffLock mutex;
+	};
+}
+
+#endif   // sw_CodeHeap_hpp
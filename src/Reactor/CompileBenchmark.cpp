@@ -0,0 +1,159 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+
+// Measures how routine generation scales with the number of threads compiling at once, like
+// renderers of several contexts missing their caches after a scene change. A fixed set of distinct
+// routines is split over the threads, and every routine is run to check it against a reference.
+//
+// Usage: swcompilebench [routines] [max threads]
+
+#include "Reactor.hpp"
+#include "Routine.hpp"
+
+#include "CPUID.hpp"
+#include "Thread.hpp"
+#include "Timer.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace sw;
+
+enum {LENGTH = 200};   // Operations per routine, about the size of a simple pixel routine
+
+static Routine *generate(int seed)
+{
+	Function<Int, Pointer<Byte> > function(RoutinePixel);
+	{
+		Pointer<Byte> data(function.arg(0));
+
+		Int4 v = *Pointer<Int4>(data);
+
+		for(int i = 0; i < LENGTH; i++)
+		{
+			v = v * Int4(seed + i, i, 3, 5) + (v >> (i % 7 + 1));
+			v = v ^ Int4(i);
+		}
+
+		Return(Extract(v, 0));
+	}
+
+	return function(L"CompileBenchmark_%d", seed);
+}
+
+static int reference(int seed, int x)
+{
+	for(int i = 0; i < LENGTH; i++)
+	{
+		x = (int)((unsigned int)x * (unsigned int)(seed + i) + (unsigned int)(x >> (i % 7 + 1)));
+		x = x ^ i;
+	}
+
+	return x;
+}
+
+struct Compilation
+{
+	int first;   // Routine indices first, first + stride, ... below count
+	int stride;
+	int count;
+	int failures;
+};
+
+static void compileFunction(void *parameters)
+{
+	Compilation *compilation = static_cast<Compilation*>(parameters);
+
+	for(int i = compilation->first; i < compilation->count; i += compilation->stride)
+	{
+		Routine *routine = generate(i);
+
+		int data[4] = {i + 1, 0, 0, 0};
+		int (*entry)(void*) = (int(*)(void*))routine->getEntry();
+
+		if(entry(data) != reference(i, i + 1))
+		{
+			compilation->failures++;
+		}
+
+		delete routine;
+	}
+
+	Nucleus::releaseThread();
+}
+
+int main(int argc, char *argv[])
+{
+	int routines = argc > 1 ? atoi(argv[1]) : 256;
+	int maxThreads = argc > 2 ? atoi(argv[2]) : CPUID::coreCount();
+
+	if(routines < 1 || maxThreads < 1 || maxThreads > 64)
+	{
+		fprintf(stderr, "Usage: %s [routines] [max threads, up to 64]\n", argv[0]);
+
+		return 1;
+	}
+
+	// Warm up, so the one-time LLVM initialization isn't timed
+	Compilation warmUp = {0, 1, 1, 0};
+	compileFunction(&warmUp);
+
+	printf("Threads  Routines/s  Speedup\n");
+
+	double single = 0;
+
+	for(int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		if(threads * 2 > maxThreads)
+		{
+			threads = maxThreads;   // Powers of two, and the maximum
+		}
+
+		Compilation compilation[64];
+		Thread *thread[64];
+
+		double start = Timer::seconds();
+
+		for(int i = 0; i < threads; i++)
+		{
+			Compilation c = {i, threads, routines, 0};
+			compilation[i] = c;
+			thread[i] = new Thread(compileFunction, &compilation[i]);
+		}
+
+		int failures = 0;
+
+		for(int i = 0; i < threads; i++)
+		{
+			delete thread[i];   // Joins
+			failures += compilation[i].failures;
+		}
+
+		double rate = routines / (Timer::seconds() - start);
+
+		if(threads == 1)
+		{
+			single = rate;
+		}
+
+		printf("%7d  %10.1f  %7.2f\n", threads, rate, rate / single);
+
+		if(failures)
+		{
+			fprintf(stderr, "%d routines computed the wrong result\n", failures);
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -24,6 +24,7 @@
 #include "llvm/Target/TargetData.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "../lib/ExecutionEngine/JIT/JIT.h"
 
 #include "Routine.hpp"
@@ -31,9 +32,19 @@
 #include "x86.hpp"
 #include "CPUID.hpp"
 #include "Thread.hpp"
+#include "Timer.hpp"
 #include "Memory.hpp"
+#include "Debug.hpp"
 
 #include <fstream>
+#include <algorithm>
+#include <string.h>
+
+#if defined(__linux__)
+	#include <stdio.h>
+	#include <stdlib.h>
+	#include <unistd.h>
+#endif
 
 #if defined(__x86_64__) && defined(_WIN32)
 extern "C" void X86CompilationCallback()
@@ -56,59 +67,72 @@ namespace llvm
 
 namespace sw
 {
-	Optimization optimization[10] = {InstructionCombining, Disabled};
+	Optimization optimization[RoutineTypeCount][10] =
+	{
+		{InstructionCombining, Disabled},
+		{InstructionCombining, Disabled},
+		{InstructionCombining, Disabled},
+		{InstructionCombining, Disabled},
+		{InstructionCombining, Disabled},
+		{InstructionCombining, Disabled},
+	};
 
-	using namespace llvm;
+	bool optimizationProfiling = false;
 
-	RoutineManager *Nucleus::routineManager = 0;
-	ExecutionEngine *Nucleus::executionEngine = 0;
-	Builder *Nucleus::builder = 0;
-	LLVMContext *Nucleus::context = 0;
-	Module *Nucleus::module = 0;
-	llvm::Function *Nucleus::function = 0;
-	BackoffLock Nucleus::codegenMutex;
+	using namespace llvm;
 
 	class Builder : public IRBuilder<>
 	{
 	};
 
-	Nucleus::Nucleus()
-	{
-		codegenMutex.lock();   // Reactor and LLVM are currently not thread safe
+	#if defined(_MSC_VER)
+		#define THREAD_LOCAL __declspec(thread)
+	#else
+		#define THREAD_LOCAL __thread
+	#endif
 
-		InitializeNativeTarget();
-		JITEmitDebugInfo = false;
+	// Each thread generates routines using its own LLVM context, module, builder and JIT,
+	// so routines for different renderers can be compiled concurrently.
+	static THREAD_LOCAL RoutineManager *routineManager = 0;
+	static THREAD_LOCAL ExecutionEngine *executionEngine = 0;
+	static THREAD_LOCAL ExecutionEngine *threadJIT[2] = {0, 0};   // Unoptimized and optimized, reused for each routine's module
+	static THREAD_LOCAL RoutineManager *threadRoutineManager[2] = {0, 0};
+	static THREAD_LOCAL unsigned int threadJITFeatures[2] = {0, 0};
+	static THREAD_LOCAL Builder *builder = 0;
+	static THREAD_LOCAL LLVMContext *context = 0;
+	static THREAD_LOCAL Module *module = 0;
+	static THREAD_LOCAL llvm::Function *function = 0;
+	static THREAD_LOCAL PassManager *passManager[RoutineTypeCount] = {0};
+	static THREAD_LOCAL Optimization passManagerList[RoutineTypeCount][10];   // The pass list each manager was built from
+	static THREAD_LOCAL PassManager *minimalPassManager = 0;   // For unoptimized routines
 
-		if(!context)
-		{
-			context = new LLVMContext();
-		}
+	static BackoffLock initializationMutex;
+	static volatile bool initialized = false;
 
-		module = new Module("", *context);
-		routineManager = new RoutineManager();
+	static OptimizationStatistics optimizationStatistics[RoutineTypeCount];
+	static BackoffLock optimizationStatisticsMutex;
 
-		#if defined(__x86_64__)
-			const char *architecture = "x86-64";
-		#else
-			const char *architecture = "x86";
-		#endif
+	static CompileStatistics compileStatistics;
+	static BackoffLock compileStatisticsMutex;
 
-		SmallVector<std::string, 1> MAttrs;
-		MAttrs.push_back(CPUID::supportsMMX()    ? "+mmx"   : "-mmx");
-		MAttrs.push_back(CPUID::supportsCMOV()   ? "+cmov"  : "-cmov");
-		MAttrs.push_back(CPUID::supportsSSE()    ? "+sse"   : "-sse");
-		MAttrs.push_back(CPUID::supportsSSE2()   ? "+sse2"  : "-sse2");
-		MAttrs.push_back(CPUID::supportsSSE3()   ? "+sse3"  : "-sse3");
-		MAttrs.push_back(CPUID::supportsSSSE3()  ? "+ssse3" : "-ssse3");
-		MAttrs.push_back(CPUID::supportsSSE4_1() ? "+sse41" : "-sse41");
+	#if defined(__linux__)
+		static FILE *perfMap = 0;   // Symbols for perf, enabled by SWIFTSHADER_PERF_MAP=1
+		static BackoffLock perfMapMutex;
+	#endif
 
-		std::string error;
-		TargetMachine *targetMachine = EngineBuilder::selectTarget(module, architecture, "", MAttrs, Reloc::Default, CodeModel::JITDefault, &error);
-		executionEngine = JIT::createJIT(module, 0, routineManager, CodeGenOpt::Aggressive, true, targetMachine);
+	static void initialize()
+	{
+		initializationMutex.lock();
 
-		if(!builder)
+		if(!initialized)
 		{
-			builder = static_cast<Builder*>(new IRBuilder<>(*context));
+			llvm_start_multithreaded();
+			InitializeNativeTarget();
+			JITEmitDebugInfo = false;
+
+			UnsafeFPMath = true;
+		//	NoInfsFPMath = true;
+		//	NoNaNsFPMath = true;
 
 			#if defined(_WIN32)
 				HMODULE CodeAnalyst = LoadLibrary("CAJitNtfyLib.dll");
@@ -121,19 +145,159 @@ namespace sw
 					CodeAnalystInitialize();
 				}
 			#endif
+
+			#if defined(__linux__)
+				const char *perfMapEnabled = getenv("SWIFTSHADER_PERF_MAP");
+
+				if(perfMapEnabled && atoi(perfMapEnabled))
+				{
+					char perfMapName[64];
+					sprintf(perfMapName, "/tmp/perf-%d.map", (int)getpid());
+					perfMap = fopen(perfMapName, "a");
+				}
+			#endif
+
+			initialized = true;
+		}
+
+		initializationMutex.unlock();
+	}
+
+	static unsigned int enabledFeatures()
+	{
+		return (CPUID::supportsMMX()    ? 0x01 : 0) |
+		       (CPUID::supportsCMOV()   ? 0x02 : 0) |
+		       (CPUID::supportsSSE()    ? 0x04 : 0) |
+		       (CPUID::supportsSSE2()   ? 0x08 : 0) |
+		       (CPUID::supportsSSE3()   ? 0x10 : 0) |
+		       (CPUID::supportsSSSE3()  ? 0x20 : 0) |
+		       (CPUID::supportsSSE4_1() ? 0x40 : 0);
+	}
+
+	// Creating the target machine and the JIT's code generation passes costs more than compiling
+	// a small routine, so each thread keeps a JIT per optimization level. It is only recreated when
+	// the enabled CPU features change. Both levels use LLVM's JIT; the unoptimized one only differs
+	// by selecting FastISel and the fast register allocator through CodeGenOpt::None.
+	static void selectJIT(bool optimize)
+	{
+		int level = optimize ? 1 : 0;
+		unsigned int features = enabledFeatures();
+
+		if(!threadJIT[level] || threadJITFeatures[level] != features)
+		{
+			delete threadJIT[level];   // Also deletes its routine manager
+
+			#if defined(__x86_64__)
+				const char *architecture = "x86-64";
+			#else
+				const char *architecture = "x86";
+			#endif
+
+			SmallVector<std::string, 1> MAttrs;
+			MAttrs.push_back(CPUID::supportsMMX()    ? "+mmx"   : "-mmx");
+			MAttrs.push_back(CPUID::supportsCMOV()   ? "+cmov"  : "-cmov");
+			MAttrs.push_back(CPUID::supportsSSE()    ? "+sse"   : "-sse");
+			MAttrs.push_back(CPUID::supportsSSE2()   ? "+sse2"  : "-sse2");
+			MAttrs.push_back(CPUID::supportsSSE3()   ? "+sse3"  : "-sse3");
+			MAttrs.push_back(CPUID::supportsSSSE3()  ? "+ssse3" : "-ssse3");
+			MAttrs.push_back(CPUID::supportsSSE4_1() ? "+sse41" : "-sse41");
+			// AVX, FMA and F16C are never enabled: the JIT's code emitter can't encode VEX prefixes
+
+			// The JIT's code generation passes belong to its first module, so an empty one is kept
+			// for as long as the JIT, while routine modules get added and removed.
+			Module *anchor = new Module("", *context);
+
+			std::string error;
+			TargetMachine *targetMachine = EngineBuilder::selectTarget(anchor, architecture, "", MAttrs, Reloc::Default, CodeModel::JITDefault, &error);
+			threadRoutineManager[level] = new RoutineManager();
+			threadJIT[level] = JIT::createJIT(anchor, 0, threadRoutineManager[level], optimize ? CodeGenOpt::Aggressive : CodeGenOpt::None, true, targetMachine);
+			threadJITFeatures[level] = features;
+		}
+
+		executionEngine = threadJIT[level];
+		routineManager = threadRoutineManager[level];
+	}
+
+	static int instructionCount()
+	{
+		int count = 0;
+
+		for(llvm::Function::const_iterator basicBlock = function->begin(); basicBlock != function->end(); basicBlock++)
+		{
+			count += basicBlock->size();
+		}
+
+		return count;
+	}
+
+	Nucleus::Nucleus(RoutineType type, bool optimize) : type(type)
+	{
+		startTime = Timer::counter();
+
+		if(!initialized)
+		{
+			initialize();
+		}
+
+		ASSERT(!module);   // Routines are generated one at a time per thread
+
+		if(!context)
+		{
+			context = new LLVMContext();
+		}
+
+		selectJIT(optimize);
+
+		module = new Module("", *context);
+		executionEngine->addModule(module);
+
+		if(!builder)
+		{
+			builder = static_cast<Builder*>(new IRBuilder<>(*context));
 		}
 	}
 
 	Nucleus::~Nucleus()
 	{
-		delete executionEngine;
-		executionEngine = 0;
+		// Deleting the module releases the JIT's mappings for its functions, but not the acquired routine
+		executionEngine->removeModule(module);
+		delete module;
 
+		executionEngine = 0;
 		routineManager = 0;
 		function = 0;
 		module = 0;
+	}
+
+	void Nucleus::releaseThread()
+	{
+		ASSERT(!module);   // Not while generating a routine
 
-		codegenMutex.unlock();
+		for(int type = 0; type < RoutineTypeCount; type++)
+		{
+			delete passManager[type];
+			passManager[type] = 0;
+		}
+
+		delete minimalPassManager;
+		minimalPassManager = 0;
+
+		for(int level = 0; level < 2; level++)
+		{
+			delete threadJIT[level];   // Also deletes its routine manager and anchor module
+			threadJIT[level] = 0;
+			threadRoutineManager[level] = 0;
+			threadJITFeatures[level] = 0;
+		}
+
+		executionEngine = 0;
+		routineManager = 0;
+
+		delete builder;
+		builder = 0;
+
+		delete context;   // After everything created within it
+		context = 0;
 	}
 
 	Routine *Nucleus::acquireRoutine(const wchar_t *name, bool runOptimizations)
@@ -159,10 +323,11 @@ namespace sw
 			module->print(file, 0);
 		}
 
-		if(runOptimizations)
-		{
-			optimize();
-		}
+		int instructionsBefore = instructionCount();
+
+		optimize(runOptimizations);
+
+		int instructionsAfter = instructionCount();
 
 		if(false)
 		{
@@ -171,58 +336,173 @@ namespace sw
 			module->print(file, 0);
 		}
 
+		int64_t codeGenerationStart = Timer::counter();
 		void *entry = executionEngine->getPointerToFunction(function);
+		int64_t codeGenerationTime = Timer::counter() - codeGenerationStart;
+
 		Routine *routine = routineManager->acquireRoutine(entry);
 
+		if(runOptimizations)
+		{
+			optimizationStatisticsMutex.lock();
+			optimizationStatistics[type].routines++;
+			optimizationStatistics[type].codeGenerationTime += codeGenerationTime;
+			optimizationStatisticsMutex.unlock();
+		}
+
+		int64_t compileTime = Timer::counter() - this->startTime;   // Since the IR started being built
+		routine->setCompileStatistics((double)compileTime / Timer::frequency(), instructionsBefore, instructionsAfter);
+
+		compileStatisticsMutex.lock();
+		compileStatistics.routines++;
+		compileStatistics.optimizedRoutines += runOptimizations ? 1 : 0;
+		compileStatistics.compileTime += compileTime;
+		compileStatistics.maxCompileTime = std::max(compileStatistics.maxCompileTime, compileTime);
+		compileStatistics.instructionsBefore += instructionsBefore;
+		compileStatistics.instructionsAfter += instructionsAfter;
+		compileStatistics.codeBytes += routine->getCodeSize();
+		compileStatisticsMutex.unlock();
+		routine->setOptimized(runOptimizations);
+
 		if(CodeAnalystLogJITCode)
 		{
 			CodeAnalystLogJITCode(routine->getEntry(), routine->getCodeSize(), name);
 		}
 
+		#if defined(__linux__)
+			if(perfMap)
+			{
+				perfMapMutex.lock();   // Routines are generated on multiple threads
+				fprintf(perfMap, "%lx %x %ls\n", (unsigned long)routine->getEntry(), routine->getCodeSize(), name);
+				fflush(perfMap);
+				perfMapMutex.unlock();
+			}
+		#endif
+
 		return routine;
 	}
 
-	void Nucleus::optimize()
+	static void addPass(PassManager *passes, Optimization optimization)
 	{
-		static PassManager *passManager = 0;
+		switch(optimization)
+		{
+		case Disabled:                                                             break;
+		case CFGSimplification:    passes->add(createCFGSimplificationPass());    break;
+		case LICM:                 passes->add(createLICMPass());                 break;
+		case AggressiveDCE:        passes->add(createAggressiveDCEPass());        break;
+		case GVN:                  passes->add(createGVNPass());                  break;
+		case InstructionCombining: passes->add(createInstructionCombiningPass()); break;
+		case Reassociate:          passes->add(createReassociatePass());          break;
+		case DeadStoreElimination: passes->add(createDeadStoreEliminationPass()); break;
+		case SCCP:                 passes->add(createSCCPPass());                 break;
+		case ScalarReplAggregates: passes->add(createScalarReplAggregatesPass()); break;
+		default:
+			assert(false);
+		}
+	}
 
-		if(!passManager)
+	void Nucleus::optimize(bool runOptimizations)
+	{
+		if(!minimalPassManager)
 		{
-			passManager = new PassManager();
+			minimalPassManager = new PassManager();
 
-			UnsafeFPMath = true;
-		//	NoInfsFPMath = true;
-		//	NoNaNsFPMath = true;
+			minimalPassManager->add(new TargetData(*executionEngine->getTargetData()));
+			minimalPassManager->add(createScalarReplAggregatesPass());   // Promotes variables to registers
+		}
+
+		if(!runOptimizations)
+		{
+			minimalPassManager->run(*module);
+
+			return;
+		}
 
-			passManager->add(new TargetData(*executionEngine->getTargetData()));
-			passManager->add(createScalarReplAggregatesPass());
+		Optimization passList[10];
+		memcpy(passList, optimization[type], sizeof(passList));   // SwiftConfig can change it during compilation
 
-			for(int pass = 0; pass < 10 && optimization[pass] != Disabled; pass++)
+		if(optimizationProfiling)
+		{
+			int64_t passTime[10] = {0};
+
+			minimalPassManager->run(*module);
+
+			for(int pass = 0; pass < 10 && passList[pass] != Disabled; pass++)
 			{
-				switch(optimization[pass])
-				{
-				case Disabled:                                                                 break;
-				case CFGSimplification:    passManager->add(createCFGSimplificationPass());    break;
-				case LICM:                 passManager->add(createLICMPass());                 break;
-				case AggressiveDCE:        passManager->add(createAggressiveDCEPass());        break;
-				case GVN:                  passManager->add(createGVNPass());                  break;
-				case InstructionCombining: passManager->add(createInstructionCombiningPass()); break;
-				case Reassociate:          passManager->add(createReassociatePass());          break;
-				case DeadStoreElimination: passManager->add(createDeadStoreEliminationPass()); break;
-				case SCCP:                 passManager->add(createSCCPPass());                 break;
-				case ScalarReplAggregates: passManager->add(createScalarReplAggregatesPass()); break;
-				default:
-					assert(false);
-				}
+				PassManager passes;
+				passes.add(new TargetData(*executionEngine->getTargetData()));
+				addPass(&passes, passList[pass]);
+
+				int64_t startTime = Timer::counter();
+				passes.run(*module);
+				passTime[pass] = Timer::counter() - startTime;
+			}
+
+			optimizationStatisticsMutex.lock();
+
+			for(int pass = 0; pass < 10; pass++)
+			{
+				optimizationStatistics[type].passTime[pass] += passTime[pass];
 			}
+
+			optimizationStatisticsMutex.unlock();
+
+			return;
 		}
 
-		passManager->run(*module);
+		PassManager *&passes = passManager[type];
+
+		if(!passes || memcmp(passManagerList[type], passList, sizeof(passList)) != 0)
+		{
+			delete passes;
+			passes = new PassManager();
+
+			passes->add(new TargetData(*executionEngine->getTargetData()));
+			passes->add(createScalarReplAggregatesPass());   // Promotes variables to registers
+
+			for(int pass = 0; pass < 10 && passList[pass] != Disabled; pass++)
+			{
+				addPass(passes, passList[pass]);
+			}
+
+			memcpy(passManagerList[type], passList, sizeof(passList));
+		}
+
+		passes->run(*module);
+	}
+
+	void getCompileStatistics(CompileStatistics &statistics)
+	{
+		compileStatisticsMutex.lock();
+		statistics = compileStatistics;
+		compileStatisticsMutex.unlock();
+	}
+
+	void getOptimizationStatistics(RoutineType type, OptimizationStatistics &statistics)
+	{
+		optimizationStatisticsMutex.lock();
+		statistics = optimizationStatistics[type];
+		optimizationStatisticsMutex.unlock();
+	}
+
+	void resetOptimizationStatistics()
+	{
+		optimizationStatisticsMutex.lock();
+		memset(optimizationStatistics, 0, sizeof(optimizationStatistics));
+		optimizationStatisticsMutex.unlock();
+	}
+
+	void addRoutineExecution(RoutineType type, int64_t ticks)
+	{
+		optimizationStatisticsMutex.lock();
+		optimizationStatistics[type].executions++;
+		optimizationStatistics[type].executionTicks += ticks;
+		optimizationStatisticsMutex.unlock();
 	}
 
-	void Nucleus::setFunction(llvm::Function *function)
+	void Nucleus::setFunction(llvm::Function *newFunction)
 	{
-		Nucleus::function = function;
+		function = newFunction;
 
 		builder->SetInsertPoint(BasicBlock::Create(*context, "", function));
 	}
@@ -6829,6 +7109,15 @@ namespace sw
 		Nucleus::createUnreachable();
 	}
 
+	void Call(RValue<Pointer<Byte> > function, RValue<Pointer<Byte> > arg1, RValue<Pointer<Byte> > arg2, RValue<Pointer<Byte> > arg3)
+	{
+		std::vector<Type*> parameters(3, Pointer<Byte>::getType());
+		FunctionType *functionType = FunctionType::get(Void::getType(), parameters, false);
+		Value *callee = Nucleus::createBitCast(function.value, PointerType::get(functionType, 0));
+
+		Nucleus::createCall(callee, arg1.value, arg2.value, arg3.value);
+	}
+
 	BasicBlock *beginLoop()
 	{
 		BasicBlock *loopBB = Nucleus::createBasicBlock();
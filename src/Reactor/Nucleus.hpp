@@ -60,7 +60,48 @@ namespace sw
 		OptimizationCount
 	};
 
-	extern Optimization optimization[10];
+	// Routine families, each compiled with its own list of optimization passes
+	enum RoutineType
+	{
+		RoutineVertex,
+		RoutineSetup,
+		RoutinePixel,
+		RoutineBlit,
+		RoutineFrameBuffer,
+		RoutineSampler,
+
+		RoutineTypeCount
+	};
+
+	extern Optimization optimization[RoutineTypeCount][10];
+	extern bool optimizationProfiling;   // Runs the passes one at a time to time them, and enables routine execution timing
+
+	struct OptimizationStatistics
+	{
+		int routines;                  // Compiled with optimizations
+		int64_t passTime[10];          // Per entry of the pass list, in Timer::counter() units
+		int64_t codeGenerationTime;
+		int64_t executions;            // Recorded by the callers of the routines
+		int64_t executionTicks;
+	};
+
+	void getOptimizationStatistics(RoutineType type, OptimizationStatistics &statistics);
+	void resetOptimizationStatistics();
+	void addRoutineExecution(RoutineType type, int64_t ticks);
+
+	// Totals for all routines generated by the process, never reset
+	struct CompileStatistics
+	{
+		int64_t routines;
+		int64_t optimizedRoutines;
+		int64_t compileTime;          // From the start of generation until the code is emitted, in Timer::counter() units
+		int64_t maxCompileTime;
+		int64_t instructionsBefore;   // IR instructions before and after optimization
+		int64_t instructionsAfter;
+		int64_t codeBytes;
+	};
+
+	void getCompileStatistics(CompileStatistics &statistics);
 
 	class Routine;
 	class RoutineManager;
@@ -69,12 +110,14 @@ namespace sw
 	class Nucleus
 	{
 	public:
-		Nucleus();
+		Nucleus(RoutineType type, bool optimize = true);   // Unoptimized routines use fast instruction selection
 
 		virtual ~Nucleus();
 
 		Routine *acquireRoutine(const wchar_t *name, bool runOptimizations = true);
 
+		static void releaseThread();   // Deletes the calling thread's LLVM state, before it exits
+
 		static void setFunction(llvm::Function *function);
 
 		static llvm::Module *getModule();
@@ -211,16 +254,10 @@ namespace sw
 		static llvm::Value *createConstantVector(llvm::Constant *const *Vals, unsigned NumVals);
 
 	private:
-		void optimize();
-
-		static llvm::ExecutionEngine *executionEngine;
-		static Builder *builder;
-		static llvm::Function *function;
-		static llvm::LLVMContext *context;
-		static llvm::Module *module;
-		static RoutineManager *routineManager;
+		void optimize(bool runOptimizations);
 
-		static BackoffLock codegenMutex;
+		const RoutineType type;
+		int64_t startTime;
 	};
 
 	class Byte;
@@ -2461,11 +2498,13 @@ namespace sw
 	template<class T>
 	void Return(RValue<Pointer<T> > ret);
 
+	void Call(RValue<Pointer<Byte> > function, RValue<Pointer<Byte> > arg1, RValue<Pointer<Byte> > arg2, RValue<Pointer<Byte> > arg3);   // Calls the entry of a void(void*, void*, void*) routine
+
 	template<class R = Void, class A1 = Void, class A2 = Void, class A3 = Void, class A4 = Void>
 	class Function
 	{
 	public:
-		Function();
+		Function(RoutineType type, bool optimize = true);
 
 		virtual ~Function();
 
@@ -2477,6 +2516,7 @@ namespace sw
 		Nucleus *core;
 		llvm::Function *function;
 		std::vector<llvm::Type*> arguments;
+		const bool optimize;
 	};
 
 	RValue<Long> Ticks();
@@ -2904,9 +2944,9 @@ namespace sw
 	}
 
 	template<class R, class A1, class A2, class A3, class A4>
-	Function<R, A1, A2, A3, A4>::Function()
+	Function<R, A1, A2, A3, A4>::Function(RoutineType type, bool optimize) : optimize(optimize)
 	{
-		core = new Nucleus();
+		core = new Nucleus(type, optimize);
 
 		if(!A1::isVoid()) arguments.push_back(A1::getType());
 		if(!A2::isVoid()) arguments.push_back(A2::getType());
@@ -2939,7 +2979,7 @@ namespace sw
 		vswprintf(fullName, 1024, name, vararg);
 		va_end(vararg);
 
-		return core->acquireRoutine(fullName, true);
+		return core->acquireRoutine(fullName, optimize);
 	}
 
 	template<class T, class S>
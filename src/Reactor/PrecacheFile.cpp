@@ -0,0 +1,476 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+#include "PrecacheFile.hpp"
+
+#include "Routine.hpp"
+#include "../Common/CPUID.hpp"
+#include "../Common/Memory.hpp"
+#include "../Common/Types.hpp"
+#include "../Common/Version.h"
+
+#include <set>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace sw
+{
+	static size_t align8(size_t size)
+	{
+		return (size + 7) & ~(size_t)7;
+	}
+
+	static unsigned int hash(unsigned int hash, const void *data, size_t size)   // FNV-1a
+	{
+		for(size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ ((const unsigned char*)data)[i]) * 16777619;
+		}
+
+		return hash;
+	}
+
+	struct Module
+	{
+		uintptr_t address;   // Of code within the module
+		unsigned int hash;
+		bool found;
+	};
+
+	static int hashBuildID(struct dl_phdr_info *info, size_t size, void *data)
+	{
+		Module &module = *(Module*)data;
+		bool contained = false;
+
+		for(int i = 0; i < info->dlpi_phnum; i++)
+		{
+			const ElfW(Phdr) &segment = info->dlpi_phdr[i];
+			uintptr_t start = info->dlpi_addr + segment.p_vaddr;
+
+			contained = contained || (segment.p_type == PT_LOAD && module.address >= start && module.address < start + segment.p_memsz);
+		}
+
+		for(int i = 0; i < info->dlpi_phnum && contained; i++)
+		{
+			const ElfW(Phdr) &segment = info->dlpi_phdr[i];
+			const unsigned char *note = (const unsigned char*)(info->dlpi_addr + segment.p_vaddr);
+			const unsigned char *end = note + (segment.p_type == PT_NOTE ? segment.p_memsz : 0);
+
+			while(note + sizeof(ElfW(Nhdr)) <= end)
+			{
+				const ElfW(Nhdr) &header = *(const ElfW(Nhdr)*)note;
+				const unsigned char *name = note + sizeof(ElfW(Nhdr));
+				const unsigned char *description = name + ((header.n_namesz + 3) & ~3);
+
+				if(header.n_type == NT_GNU_BUILD_ID && header.n_namesz == 4 && memcmp(name, "GNU", 4) == 0)
+				{
+					module.hash = hash(module.hash, description, header.n_descsz);
+					module.found = true;
+				}
+
+				note = description + ((header.n_descsz + 3) & ~3);
+			}
+		}
+
+		return contained ? 1 : 0;
+	}
+
+	// The code generators can change in an incremental build which doesn't recompile this file, so the
+	// routines are only reused by the same module. The linker's build ID identifies it, or otherwise
+	// the module file's size and modification time do.
+	static unsigned int moduleHash()
+	{
+		Module module = {(uintptr_t)&moduleHash, 2166136261, false};
+		dl_iterate_phdr(hashBuildID, &module);
+
+		Dl_info info;
+		struct stat status;
+
+		if(!module.found && dladdr((void*)&moduleHash, &info) && info.dli_fname && stat(info.dli_fname, &status) == 0)
+		{
+			module.hash = hash(module.hash, &status.st_size, sizeof(status.st_size));
+			module.hash = hash(module.hash, &status.st_mtime, sizeof(status.st_mtime));
+			module.found = true;
+		}
+
+		return module.found ? module.hash : 0;
+	}
+
+	PrecacheFile::PrecacheFile(const char *name, int keySize, const void *constants, int constSize, bool readOnly) : keySize(keySize), constants(constants), constSize(constSize)
+	{
+		mapping = 0;
+		mappingSize = 0;
+
+		#if !defined(__x86_64__)
+			file = -1;   // Relative calls can't be found by scanning the code for absolute addresses
+
+			return;
+		#endif
+
+		file = readOnly ? open(name, O_RDONLY) : open(name, O_RDWR | O_APPEND | O_CREAT, 0644);
+
+		if(file < 0)
+		{
+			return;
+		}
+
+		Header header;
+		initializeHeader(header, keySize);
+
+		flock(file, readOnly ? LOCK_SH : LOCK_EX);   // Other processes may be appending or validating
+
+		struct stat status;
+		bool valid = fstat(file, &status) == 0 && status.st_size >= (off_t)sizeof(Header);
+
+		if(valid)
+		{
+			mappingSize = status.st_size;
+			mapping = mmap(0, mappingSize, PROT_READ, MAP_SHARED, file, 0);
+
+			if(mapping == MAP_FAILED)
+			{
+				mapping = 0;
+				valid = false;
+			}
+			else
+			{
+				valid = memcmp(mapping, &header, sizeof(Header)) == 0;
+			}
+		}
+
+		if(!valid)   // Missing, from another build, or compiled for other CPU features
+		{
+			if(mapping)
+			{
+				munmap(mapping, mappingSize);
+				mapping = 0;
+			}
+
+			mappingSize = 0;
+
+			if(readOnly || ftruncate(file, 0) != 0 || write(file, &header, sizeof(Header)) != sizeof(Header))
+			{
+				flock(file, LOCK_UN);
+				close(file);
+				file = -1;
+
+				return;
+			}
+		}
+
+		flock(file, LOCK_UN);
+
+		if(readOnly)
+		{
+			close(file);   // The mapping stays valid
+			file = -1;
+		}
+
+		parseRecords((const unsigned char*)mapping, mappingSize, keySize, records);
+	}
+
+	PrecacheFile::~PrecacheFile()
+	{
+		if(mapping)
+		{
+			munmap(mapping, mappingSize);
+		}
+
+		if(file >= 0)
+		{
+			close(file);
+		}
+	}
+
+	int PrecacheFile::getRoutineCount()
+	{
+		return (int)records.size();
+	}
+
+	const void *PrecacheFile::getKey(int i)
+	{
+		return records[i] + 1;
+	}
+
+	Routine *PrecacheFile::loadRoutine(int i)
+	{
+		const Record *record = records[i];
+		const Relocation *relocation = (const Relocation*)((const unsigned char*)(record + 1) + align8(keySize));
+		const unsigned char *code = (const unsigned char*)(relocation + record->relocationCount);
+		const char *symbols = (const char*)(code + align8(record->functionSize));
+		size_t symbolsSize = (const char*)record + record->size - symbols;
+
+		Routine *routine = new Routine(record->functionSize);
+		unsigned char *buffer = (unsigned char*)routine->buffer;
+		memcpy(buffer, code, record->functionSize);
+
+		for(unsigned int j = 0; j < record->relocationCount; j++)
+		{
+			uintptr_t address = 0;
+
+			if(relocation[j].offset + sizeof(uintptr_t) <= record->functionSize)
+			{
+				switch(relocation[j].type)
+				{
+				case RELOCATION_INTERNAL:
+					address = (uintptr_t)buffer + (uintptr_t)relocation[j].target;
+					break;
+				case RELOCATION_CONSTANTS:
+					address = constants ? (uintptr_t)constants + (uintptr_t)relocation[j].target : 0;
+					break;
+				case RELOCATION_SYMBOL:
+					if(relocation[j].target < symbolsSize && memchr(symbols + relocation[j].target, 0, symbolsSize - (size_t)relocation[j].target))
+					{
+						address = (uintptr_t)dlsym(RTLD_DEFAULT, symbols + relocation[j].target);
+					}
+					break;
+				}
+			}
+
+			if(!address)   // Can't be resolved in this process
+			{
+				delete routine;
+
+				return 0;
+			}
+
+			memcpy(&buffer[relocation[j].offset], &address, sizeof(address));
+		}
+
+		routine->entry = buffer + record->entryOffset;
+		routine->setFunctionSize(record->functionSize);
+
+		return routine;
+	}
+
+	void PrecacheFile::addRoutine(const void *key, Routine *routine)
+	{
+		if(file < 0)
+		{
+			return;
+		}
+
+		const unsigned char *buffer = (const unsigned char*)routine->getBuffer();
+		const unsigned char *entry = (const unsigned char*)routine->getEntry();
+		int functionSize = routine->getFunctionSize();
+
+		std::vector<Relocation> relocations;
+		std::string symbols;
+
+		// Absolute addresses are found by scanning the code, like for the Windows DLL precache
+		for(int j = 0; j + (int)sizeof(uintptr_t) <= functionSize; j++)
+		{
+			uintptr_t address;
+			memcpy(&address, &buffer[j], sizeof(address));
+
+			Relocation relocation;
+			relocation.offset = j;
+
+			Dl_info symbol;
+
+			if(address >= (uintptr_t)buffer && address < (uintptr_t)buffer + functionSize)
+			{
+				relocation.type = RELOCATION_INTERNAL;
+				relocation.target = address - (uintptr_t)buffer;
+			}
+			else if(constants && address >= (uintptr_t)constants && address < (uintptr_t)constants + constSize)
+			{
+				relocation.type = RELOCATION_CONSTANTS;
+				relocation.target = address - (uintptr_t)constants;
+			}
+			else if(address > 0xFFFF && dladdr((void*)address, &symbol))
+			{
+				if(!symbol.dli_sname || symbol.dli_saddr != (void*)address)
+				{
+					return;   // Points into a module but can't be relocated by name, so it would be stale under ASLR
+				}
+
+				relocation.type = RELOCATION_SYMBOL;
+				relocation.target = symbols.size();
+				symbols.append(symbol.dli_sname, strlen(symbol.dli_sname) + 1);
+			}
+			else
+			{
+				continue;
+			}
+
+			relocations.push_back(relocation);
+			j += sizeof(uintptr_t) - 1;
+		}
+
+		Record record;
+		record.functionSize = functionSize;
+		record.entryOffset = (unsigned int)(entry - buffer);
+		record.relocationCount = (unsigned int)relocations.size();
+		record.size = (unsigned int)(sizeof(Record) + align8(keySize) + relocations.size() * sizeof(Relocation) + align8(functionSize) + align8(symbols.size()));
+
+		std::vector<unsigned char> data(record.size, 0);
+		unsigned char *pointer = &data[0];
+
+		memcpy(pointer, &record, sizeof(Record));
+		pointer += sizeof(Record);
+		memcpy(pointer, key, keySize);
+		pointer += align8(keySize);
+
+		if(!relocations.empty())
+		{
+			memcpy(pointer, &relocations[0], relocations.size() * sizeof(Relocation));
+			pointer += relocations.size() * sizeof(Relocation);
+		}
+
+		memcpy(pointer, buffer, functionSize);
+		pointer += align8(functionSize);
+		memcpy(pointer, symbols.data(), symbols.size());
+
+		appendMutex.lock();
+
+		if(file >= 0)
+		{
+			// Appended as a whole, so readers never see a partial record
+			flock(file, LOCK_EX);
+			ssize_t written = write(file, &data[0], data.size());
+			flock(file, LOCK_UN);
+
+			if(written != (ssize_t)data.size())
+			{
+				close(file);   // Stop appending, the truncated record is ignored on load
+				file = -1;
+			}
+		}
+
+		appendMutex.unlock();
+	}
+
+	int PrecacheFile::merge(const char *output, const char *const *inputs, int inputCount)
+	{
+		std::vector<std::string> contents(inputCount);
+		std::vector<const Record*> records;
+		Header header;
+
+		for(int i = 0; i < inputCount; i++)
+		{
+			FILE *input = fopen(inputs[i], "rb");
+
+			if(!input)
+			{
+				return -1;
+			}
+
+			char block[4096];
+			size_t size;
+
+			while((size = fread(block, 1, sizeof(block), input)) > 0)
+			{
+				contents[i].append(block, size);
+			}
+
+			fclose(input);
+
+			if(contents[i].size() < sizeof(Header))
+			{
+				return -1;
+			}
+
+			// Recorded by the build and CPU features of the process, rather than those of this tool
+			if(i == 0)
+			{
+				memcpy(&header, contents[0].data(), sizeof(Header));
+
+				if(memcmp(header.magic, "SWRC", 4) != 0)
+				{
+					return -1;
+				}
+			}
+			else if(memcmp(contents[i].data(), &header, sizeof(Header)) != 0)
+			{
+				return -1;
+			}
+
+			parseRecords((const unsigned char*)contents[i].data(), contents[i].size(), header.keySize, records);
+		}
+
+		// Later records replace earlier ones, like they take precedence when loading
+		std::vector<const Record*> merged;
+		std::set<std::string> keys;
+
+		for(int i = (int)records.size() - 1; i >= 0; i--)
+		{
+			if(keys.insert(std::string((const char*)(records[i] + 1), header.keySize)).second)
+			{
+				merged.push_back(records[i]);
+			}
+		}
+
+		FILE *file = fopen(output, "wb");
+
+		if(!file)
+		{
+			return -1;
+		}
+
+		bool written = fwrite(&header, sizeof(Header), 1, file) == 1;
+
+		for(int i = (int)merged.size() - 1; i >= 0 && written; i--)
+		{
+			written = fwrite(merged[i], merged[i]->size, 1, file) == 1;
+		}
+
+		written = fclose(file) == 0 && written;
+
+		return written ? (int)merged.size() : -1;
+	}
+
+	void PrecacheFile::parseRecords(const unsigned char *data, size_t size, int keySize, std::vector<const Record*> &records)
+	{
+		size_t offset = sizeof(Header);
+
+		while(offset + sizeof(Record) <= size)
+		{
+			const Record *record = (const Record*)&data[offset];
+			size_t minimumSize = sizeof(Record) + align8(keySize) + (size_t)record->relocationCount * sizeof(Relocation) + align8(record->functionSize);
+
+			if(record->size < minimumSize || record->size % 8 != 0 || offset + record->size > size || record->entryOffset >= record->functionSize)
+			{
+				break;   // Truncated or corrupt
+			}
+
+			records.push_back(record);
+			offset += record->size;
+		}
+	}
+
+	void PrecacheFile::initializeHeader(Header &header, int keySize)
+	{
+		memset(&header, 0, sizeof(Header));
+
+		memcpy(header.magic, "SWRC", 4);
+		header.version = 2;
+		header.keySize = keySize;
+		header.pointerSize = sizeof(void*);
+		header.features = (CPUID::supportsMMX()    ? 0x01 : 0) |
+		                  (CPUID::supportsCMOV()   ? 0x02 : 0) |
+		                  (CPUID::supportsSSE()    ? 0x04 : 0) |
+		                  (CPUID::supportsSSE2()   ? 0x08 : 0) |
+		                  (CPUID::supportsSSE3()   ? 0x10 : 0) |
+		                  (CPUID::supportsSSSE3()  ? 0x20 : 0) |
+		                  (CPUID::supportsSSE4_1() ? 0x40 : 0);
+		header.module = moduleHash();
+		strncpy(header.build, REVISION_STRING " " __DATE__ " " __TIME__, sizeof(header.build) - 1);
+	}
+}
@@ -0,0 +1,96 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+#ifndef sw_PrecacheFile_hpp
+#define sw_PrecacheFile_hpp
+
+#include "../Common/MutexLock.hpp"
+
+#include <vector>
+#include <stddef.h>
+
+namespace sw
+{
+	class Routine;
+
+	// Memory-mapped file of relocatable routines, keyed by processor state. Routines are appended
+	// as they get compiled, so concurrent processes can share the file. It is discarded when the
+	// build or the enabled CPU features don't match. Read-only files are shipped prebuilt, and are
+	// never truncated or appended to. Only used on x86-64, where routines address other modules
+	// and constants with absolute moves.
+	class PrecacheFile
+	{
+	public:
+		PrecacheFile(const char *name, int keySize, const void *constants = 0, int constSize = 0, bool readOnly = false);
+
+		~PrecacheFile();
+
+		int getRoutineCount();
+		const void *getKey(int i);
+		Routine *loadRoutine(int i);   // Copies the code to executable memory and applies the relocations
+
+		void addRoutine(const void *key, Routine *routine);   // Thread-safe
+
+		// Combines files recorded by the same build, keeping the newest routine for each key.
+		// Returns the number of routines written, or -1 when an input is unreadable or mismatched.
+		static int merge(const char *output, const char *const *inputs, int inputCount);
+
+	private:
+		enum RelocationType
+		{
+			RELOCATION_INTERNAL,    // Address within the routine's buffer (constant pool)
+			RELOCATION_CONSTANTS,   // Address within the renderer's constants
+			RELOCATION_SYMBOL       // Exported function or variable, resolved by name
+		};
+
+		struct Header
+		{
+			char magic[4];
+			unsigned int version;
+			unsigned int keySize;
+			unsigned int pointerSize;
+			unsigned int features;   // Enabled CPUID features the routines were compiled for
+			unsigned int module;     // Build ID of the module containing the code generators
+			char build[56];
+		};
+
+		struct Record
+		{
+			unsigned int size;   // Including key, relocations, code and symbol names, 8-byte aligned
+			unsigned int functionSize;
+			unsigned int entryOffset;
+			unsigned int relocationCount;
+		};
+
+		struct Relocation
+		{
+			unsigned int offset;   // Of the address within the code
+			unsigned int type;
+			unsigned long long target;   // Offset within the buffer or constants, or of the symbol name
+		};
+
+		static void initializeHeader(Header &header, int keySize);
+		static void parseRecords(const unsigned char *data, size_t size, int keySize, std::vector<const Record*> &records);
+
+		int file;
+		MutexLock appendMutex;   // Between this process's threads, which share the file lock
+		void *mapping;
+		size_t mappingSize;
+
+		const int keySize;
+		const void *const constants;
+		const int constSize;
+
+		std::vector<const Record*> records;
+	};
+}
+
+#endif   // sw_PrecacheFile_hpp
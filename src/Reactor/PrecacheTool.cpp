@@ -0,0 +1,43 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+
+// Merges routine caches recorded with the Precache option enabled into one file to be shipped
+// with an application, and loaded from the directory named by SWIFTSHADER_PRECACHE_DIR.
+//
+// Usage: swprecache sw-pixel.cache recorded/*/sw-pixel.cache
+
+#include "PrecacheFile.hpp"
+
+#include <stdio.h>
+
+int main(int argc, char *argv[])
+{
+	if(argc < 3)
+	{
+		fprintf(stderr, "Usage: %s output.cache input.cache...\n", argv[0]);
+
+		return 1;
+	}
+
+	int count = sw::PrecacheFile::merge(argv[1], argv + 2, argc - 2);
+
+	if(count < 0)
+	{
+		fprintf(stderr, "%s: inputs must be readable and recorded by the same build and CPU features\n", argv[0]);
+
+		return 1;
+	}
+
+	printf("%s: %d routines\n", argv[1], count);
+
+	return 0;
+}
@@ -1,6 +1,6 @@
 #include "Routine.hpp"
 
-#include "../Common/Memory.hpp"
+#include "CodeHeap.hpp"
 #include "../Common/Thread.hpp"
 #include "../Common/Types.hpp"
 
@@ -8,13 +8,20 @@ namespace sw
 {
 	Routine::Routine(int bufferSize) : bufferSize(bufferSize), dynamic(true)
 	{
-		void *memory = allocateExecutable(bufferSize);
+		void *memory = CodeHeap::allocate(bufferSize);
 
 		buffer = memory;
 		entry = memory;
 		functionSize = bufferSize;   // Updated by RoutineManager::endFunctionBody
 
 		bindCount = 0;
+		optimized = true;
+		precachable = true;
+		useCount = 0;
+
+		compileTime = 0;
+		instructionsBefore = 0;
+		instructionsAfter = 0;
 	}
 
 	Routine::Routine(void *memory, int bufferSize, int offset) : bufferSize(bufferSize), functionSize(bufferSize), dynamic(false)
@@ -23,13 +30,20 @@ namespace sw
 		entry = memory;
 
 		bindCount = 0;
+		optimized = true;
+		precachable = true;
+		useCount = 0;
+
+		compileTime = 0;
+		instructionsBefore = 0;
+		instructionsAfter = 0;
 	}
 
 	Routine::~Routine()
 	{
 		if(dynamic)
 		{
-			deallocateExecutable(buffer, bufferSize);
+			CodeHeap::deallocate(buffer, bufferSize);
 		}
 	}
 
@@ -68,6 +82,53 @@ namespace sw
 		return dynamic;
 	}
 
+	void Routine::setOptimized(bool optimized)
+	{
+		this->optimized = optimized;
+	}
+
+	bool Routine::isOptimized()
+	{
+		return optimized;
+	}
+
+	void Routine::setPrecachable(bool precachable)
+	{
+		this->precachable = precachable;
+	}
+
+	bool Routine::isPrecachable()
+	{
+		return precachable;
+	}
+
+	int Routine::use()
+	{
+		return atomicIncrement(&useCount);
+	}
+
+	void Routine::setCompileStatistics(double compileTime, int instructionsBefore, int instructionsAfter)
+	{
+		this->compileTime = compileTime;
+		this->instructionsBefore = instructionsBefore;
+		this->instructionsAfter = instructionsAfter;
+	}
+
+	double Routine::getCompileTime()
+	{
+		return compileTime;
+	}
+
+	int Routine::getInstructionsBefore()
+	{
+		return instructionsBefore;
+	}
+
+	int Routine::getInstructionsAfter()
+	{
+		return instructionsAfter;
+	}
+
 	void Routine::bind()
 	{
 		atomicIncrement(&bindCount);
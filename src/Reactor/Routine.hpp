@@ -4,10 +4,12 @@
 namespace sw
 {
 	class RoutineManager;
+	class PrecacheFile;
 
 	class Routine
 	{
 		friend class RoutineManager;
+		friend class PrecacheFile;
 
 	public:
 		Routine(int bufferSize);
@@ -24,6 +26,17 @@ namespace sw
 		int getCodeSize();       // Executable code only
 		bool isDynamic();
 
+		void setOptimized(bool optimized);
+		bool isOptimized();
+		void setPrecachable(bool precachable);
+		bool isPrecachable();   // False when the code refers to addresses which can't be relocated
+		int use();   // Returns the number of uses, for recompiling hot unoptimized routines
+
+		void setCompileStatistics(double compileTime, int instructionsBefore, int instructionsAfter);
+		double getCompileTime();         // Seconds, zero for precompiled routines
+		int getInstructionsBefore();     // IR instructions before and after optimization
+		int getInstructionsAfter();
+
 		void bind();
 		void unbind();
 
@@ -35,6 +48,13 @@ namespace sw
 
 		volatile int bindCount;
 		const bool dynamic;   // Generated or precompiled
+		bool optimized;
+		bool precachable;
+		volatile int useCount;
+
+		double compileTime;
+		int instructionsBefore;
+		int instructionsAfter;
 	};
 }
 
@@ -12,6 +12,7 @@
 #include "RoutineManager.hpp"
 
 #include "Routine.hpp"
+#include "CodeHeap.hpp"
 #include "llvm/Function.h"
 #include "../Common/Memory.hpp"
 #include "../Common/Thread.hpp"
@@ -73,7 +74,12 @@ namespace sw
 
 	void RoutineManager::endFunctionBody(const llvm::Function *function, uint8_t *functionStart, uint8_t *functionEnd)
 	{
-		routine->setFunctionSize(functionEnd - functionStart);
+		int functionSize = (int)(functionEnd - functionStart);
+		routine->setFunctionSize(functionSize);
+
+		// The size was estimated, so return the unused pages to the code heap
+		CodeHeap::shrink(routine->buffer, routine->bufferSize, functionSize);
+		routine->bufferSize = functionSize;
 	}
 
 	uint8_t *RoutineManager::startExceptionTable(const llvm::Function* F, uintptr_t &ActualSize)
@@ -125,7 +131,7 @@ namespace sw
 
 	void RoutineManager::setMemoryExecutable()
 	{
-		markExecutable(routine->buffer, routine->bufferSize);
+		// The code heap's slabs are already executable
 	}
 
 	void RoutineManager::setPoisonMemory(bool poison)
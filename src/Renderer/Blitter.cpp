@@ -12,6 +12,7 @@
 #include "Blitter.hpp"
 
 #include "Common/Debug.hpp"
+#include "Common/Timer.hpp"
 #include "Reactor/Reactor.hpp"
 
 namespace sw
@@ -174,7 +175,7 @@ namespace sw
 
 	Routine *Blitter::generate(BlitState &state)
 	{
-		Function<Void, Pointer<Byte> > function;
+		Function<Void, Pointer<Byte> > function(RoutineBlit);
 		{
 			Pointer<Byte> blit(function.arg(0));
 
@@ -397,6 +398,7 @@ namespace sw
 		}
 
 		BlitState state;
+		memset(&state, 0, sizeof(BlitState));   // Compared and hashed as a whole
 
 		bool useSourceInternal = !source->isExternalDirty();
 		bool useDestInternal = !dest->isExternalDirty();
@@ -404,6 +406,7 @@ namespace sw
 		state.sourceFormat = source->getFormat(useSourceInternal);
 		state.destFormat = dest->getFormat(useDestInternal);
 		state.filter = filter;
+		state.hash = (state.sourceFormat * 31 + state.destFormat) * 2 + state.filter;
 
 		criticalSection.lock();
 		Routine *blitRoutine = blitCache->query(state);
@@ -445,8 +448,15 @@ namespace sw
 		data.sWidth = source->getWidth();
 		data.sHeight = source->getHeight();
 
+		int64_t startTick = optimizationProfiling ? Timer::ticks() : 0;
+
 		blitFunction(&data);
 
+		if(optimizationProfiling)
+		{
+			addRoutineExecution(RoutineBlit, Timer::ticks() - startTick);
+		}
+
 		source->unlock(useSourceInternal);
 		dest->unlock(useDestInternal);
 
@@ -32,6 +32,8 @@ namespace sw
 			Format sourceFormat;
 			Format destFormat;
 			bool filter;
+
+			unsigned int hash;
 		};
 
 		struct BlitData
@@ -0,0 +1,233 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+
+// Measures the cost of a routine cache lookup against how full the cache is. Keys are the size of
+// a pixel processor state and are hashed the same way. Hits and misses are timed on one thread,
+// then hits are timed on several threads at once, sharing the lock like RoutineCache::acquire().
+//
+// Usage: swcachelookup [cache size]
+
+#include "LRUCache.hpp"
+
+#include "Common/MutexLock.hpp"
+#include "Common/Thread.hpp"
+#include "Common/Timer.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Key
+{
+	Key()
+	{
+		memset(this, 0, sizeof(Key));
+	}
+
+	explicit Key(int seed)
+	{
+		memset(this, 0, sizeof(Key));
+
+		for(int i = 0; i < (int)sizeof(state) / 4; i++)
+		{
+			state[i] = (unsigned int)seed * 2654435761u + i;
+		}
+
+		hash = 2166136261;   // FNV-1a on 32-bit words, like PixelProcessor::States::computeHash()
+
+		for(int i = 0; i < (int)sizeof(state) / 4; i++)
+		{
+			hash = (hash ^ state[i]) * 16777619;
+		}
+	}
+
+	bool operator==(const Key &key) const
+	{
+		if(hash != key.hash)
+		{
+			return false;
+		}
+
+		return memcmp(state, key.state, sizeof(state)) == 0;
+	}
+
+	unsigned int state[51];   // Like sizeof(PixelProcessor::State)
+	unsigned int hash;
+};
+
+struct Data
+{
+	Data()
+	{
+		bindCount = 0;
+	}
+
+	void bind()
+	{
+		sw::atomicIncrement(&bindCount);
+	}
+
+	void unbind()
+	{
+		if(sw::atomicDecrement(&bindCount) == 0)
+		{
+			delete this;
+		}
+	}
+
+	volatile int bindCount;
+};
+
+struct Lookups
+{
+	sw::LRUCache<Key, Data> *cache;
+	sw::ReadWriteLock *mutex;
+	const Key *keys;
+	int keyCount;
+	int iterations;
+	volatile int found;
+	int64_t ticks;
+};
+
+static void lookupFunction(void *parameters)
+{
+	Lookups *lookups = static_cast<Lookups*>(parameters);
+	int found = 0;
+	int k = 0;
+
+	int64_t start = sw::Timer::ticks();
+
+	for(int i = 0; i < lookups->iterations; i++)
+	{
+		k = (k + 7919) % lookups->keyCount;   // Strided, so consecutive lookups use different buckets
+		const Key &key = lookups->keys[k];
+
+		lookups->mutex->lockShared();
+
+		Data *data = lookups->cache->query(key);
+
+		if(data)
+		{
+			data->bind();
+		}
+
+		lookups->mutex->unlockShared();
+
+		if(data)
+		{
+			data->unbind();
+			found++;
+		}
+	}
+
+	lookups->ticks = sw::Timer::ticks() - start;
+	lookups->found = found;
+}
+
+int main(int argc, char *argv[])
+{
+	int size = argc > 1 ? atoi(argv[1]) : 1024;
+
+	if(size < 1)
+	{
+		fprintf(stderr, "Usage: %s [cache size]\n", argv[0]);
+
+		return 1;
+	}
+
+	// Calibrate the time stamp counter against wall clock time
+	double startSeconds = sw::Timer::seconds();
+	int64_t startTicks = sw::Timer::ticks();
+	sw::Thread::sleep(100);
+	double ticksPerNanosecond = (sw::Timer::ticks() - startTicks) / ((sw::Timer::seconds() - startSeconds) * 1.0e9);
+
+	const int iterations = 1000000;
+
+	Key *keys = new Key[2 * size];   // The second half is never added, for misses
+
+	for(int i = 0; i < 2 * size; i++)
+	{
+		keys[i] = Key(i);
+	}
+
+	printf("Entries  Hit (ns)  Miss (ns)\n");
+
+	for(int fill = 1; fill <= size; fill *= 4)
+	{
+		sw::LRUCache<Key, Data> cache(size);
+		sw::ReadWriteLock mutex;
+
+		for(int i = 0; i < fill; i++)
+		{
+			Data *evicted = cache.add(keys[i], new Data());
+
+			if(evicted)
+			{
+				evicted->unbind();
+			}
+		}
+
+		Lookups hits = {&cache, &mutex, keys, fill, iterations, 0, 0};
+		lookupFunction(&hits);
+
+		Lookups misses = {&cache, &mutex, keys + size, size, iterations, 0, 0};
+		lookupFunction(&misses);
+
+		if(hits.found != iterations || misses.found != 0)
+		{
+			fprintf(stderr, "Lookup returned the wrong entry\n");
+
+			return 1;
+		}
+
+		printf("%7d  %8.1f  %9.1f\n", fill, hits.ticks / ticksPerNanosecond / iterations, misses.ticks / ticksPerNanosecond / iterations);
+	}
+
+	printf("\nThreads  Hit (ns)  Lookups/s\n");
+
+	sw::LRUCache<Key, Data> cache(size);
+	sw::ReadWriteLock mutex;
+
+	for(int i = 0; i < size; i++)
+	{
+		cache.add(keys[i], new Data());
+	}
+
+	for(int threads = 1; threads <= 16; threads *= 2)
+	{
+		Lookups lookups[16];
+		sw::Thread *thread[16];
+
+		for(int i = 0; i < threads; i++)
+		{
+			Lookups lookup = {&cache, &mutex, keys, size, iterations, 0, 0};
+			lookups[i] = lookup;
+			thread[i] = new sw::Thread(lookupFunction, &lookups[i]);
+		}
+
+		int64_t ticks = 0;
+
+		for(int i = 0; i < threads; i++)
+		{
+			delete thread[i];   // Joins
+			ticks += lookups[i].ticks;
+		}
+
+		double nanoseconds = ticks / ticksPerNanosecond / threads / iterations;
+
+		printf("%7d  %8.1f  %9.0f\n", threads, nanoseconds, threads * 1.0e9 / nanoseconds);
+	}
+
+	delete[] keys;
+
+	return 0;
+}
@@ -16,6 +16,9 @@
 
 namespace sw
 {
+	// Hashed on Key::hash, with least recently used entries approximated by a clock. Queries don't
+	// modify the structure so they can run concurrently, while adding, replacing or evicting requires
+	// exclusive access. Displaced data is returned still bound, for the caller to unbind.
 	template<class Key, class Data>
 	class LRUCache
 	{
@@ -25,20 +28,33 @@ namespace sw
 		~LRUCache();
 
 		Data *query(const Key &key) const;
-		Data *add(const Key &key, Data *data);
+		Data *add(const Key &key, Data *data);       // Returns the evicted data, or null
+		Data *replace(const Key &key, Data *data);   // Keeps the entry's position, or adds it
+		Data *evict();                               // Drops the least recently used entry
 		
 		int getSize() {return size;}
-		Key &getKey(int i) {return key[i];}
+		int getCount() {return count;}
+		Key &getKey(int i) {return entry[i].key;}
 
 	private:
+		struct Entry
+		{
+			Key key;
+			Data *data;
+			int next;                          // Next entry in the same bucket, or -1
+			mutable volatile bool referenced;  // Set when used, cleared when the clock hand passes
+		};
+
+		int find(const Key &key) const;
+		void unlink(int index);
+
 		int size;
+		int count;
 		int mask;
-		int top;
-		int fill;
+		int hand;   // Next eviction candidate
 
-		Key *key;
-		Key **ref;
-		Data **data;
+		Entry *entry;
+		int *bucket;   // Most recently added entry per hash, or -1
 	};
 }
 
@@ -48,94 +64,164 @@ namespace sw
 	LRUCache<Key, Data>::LRUCache(int n)
 	{
 		size = ceilPow2(n);
+		count = 0;
 		mask = size - 1;
-		top = 0;
-		fill = 0;
+		hand = 0;
 
-		key = new Key[size];
-		ref = new Key*[size];
-		data = new Data*[size];
+		entry = new Entry[size];
+		bucket = new int[size];
 		
 		for(int i = 0; i < size; i++)
 		{
-			data[i] = 0;
+			entry[i].data = 0;
+			entry[i].next = -1;
+			entry[i].referenced = false;
 
-			ref[i] = &key[i];
+			bucket[i] = -1;
 		}
 	}
 
 	template<class Key, class Data>
 	LRUCache<Key, Data>::~LRUCache()
 	{
-		delete[] key;
-		key = 0;
-
-		delete[] ref;
-		ref = 0;
-
 		for(int i = 0; i < size; i++)
 		{
-			if(data[i])
+			if(entry[i].data)
 			{
-				data[i]->unbind();
-				data[i] = 0;
+				entry[i].data->unbind();
+				entry[i].data = 0;
 			}
 		}
 
-		delete[] data;
-		data = 0;
+		delete[] entry;
+		entry = 0;
+
+		delete[] bucket;
+		bucket = 0;
 	}
 
 	template<class Key, class Data>
 	Data *LRUCache<Key, Data>::query(const Key &key) const
 	{
-		for(int i = top; i > top - fill; i--)
+		int i = find(key);
+
+		if(i < 0)
 		{
-			int j = i & mask;
+			return 0;   // Not found
+		}
 
-			if(key == *ref[j])
-			{
-				Data *hit = data[j];
+		if(!entry[i].referenced)
+		{
+			entry[i].referenced = true;
+		}
 
-				if(i != top)
-				{
-					// Move one up
-					int k = (j + 1) & mask;
+		return entry[i].data;
+	}
+	
+	template<class Key, class Data>
+	Data *LRUCache<Key, Data>::add(const Key &key, Data *data)
+	{
+		// Evict the first entry not used since the hand last passed it
+		while(entry[hand].data && entry[hand].referenced)
+		{
+			entry[hand].referenced = false;
+			hand = (hand + 1) & mask;
+		}
 
-					Data *swapD = data[k];
-					data[k] = data[j];
-					data[j] = swapD;
+		int i = hand;
+		hand = (hand + 1) & mask;
 
-					Key *swapK = ref[k];
-					ref[k] = ref[j];
-					ref[j] = swapK;
-				}
+		data->bind();
 
-				return hit;
-			}
+		Data *evicted = entry[i].data;
+
+		if(evicted)
+		{
+			unlink(i);
+		}
+		else
+		{
+			count++;
 		}
 
-		return 0;   // Not found
+		int b = key.hash & mask;
+
+		entry[i].key = key;
+		entry[i].data = data;
+		entry[i].referenced = true;
+		entry[i].next = bucket[b];
+		bucket[b] = i;   // Shadows older entries with the same key
+
+		return evicted;
 	}
-	
+
 	template<class Key, class Data>
-	Data *LRUCache<Key, Data>::add(const Key &key, Data *data)
+	Data *LRUCache<Key, Data>::replace(const Key &key, Data *data)
 	{
-		top = (top + 1) & mask;
-		fill = fill + 1 < size ? fill + 1 : size;
+		int i = find(key);
+
+		if(i < 0)
+		{
+			return add(key, data);
+		}
+
+		Data *replaced = entry[i].data;
 
-		*ref[top] = key;
-	
 		data->bind();
-		
-		if(this->data[top])
+		entry[i].data = data;
+
+		return replaced;
+	}
+
+	template<class Key, class Data>
+	Data *LRUCache<Key, Data>::evict()
+	{
+		if(count == 0)
+		{
+			return 0;
+		}
+
+		while(!entry[hand].data || entry[hand].referenced)
+		{
+			entry[hand].referenced = false;
+			hand = (hand + 1) & mask;
+		}
+
+		Data *evicted = entry[hand].data;
+
+		unlink(hand);
+		entry[hand].data = 0;
+		count--;
+
+		return evicted;   // The hand stays on the free entry, for the next add to fill
+	}
+
+	template<class Key, class Data>
+	int LRUCache<Key, Data>::find(const Key &key) const
+	{
+		for(int i = bucket[key.hash & mask]; i >= 0; i = entry[i].next)
 		{
-			this->data[top]->unbind();
+			if(key == entry[i].key)
+			{
+				return i;
+			}
 		}
 
-		this->data[top] = data;
+		return -1;
+	}
+
+	template<class Key, class Data>
+	void LRUCache<Key, Data>::unlink(int index)
+	{
+		int *link = &bucket[entry[index].key.hash & mask];
+
+		while(*link != index)
+		{
+			link = &entry[*link].next;
+		}
 
-		return data;
+		*link = entry[index].next;
+		entry[index].next = -1;
 	}
 }
 
@@ -18,6 +18,7 @@
 #include "Primitive.hpp"
 #include "Constants.hpp"
 #include "Debug.hpp"
+#include "Main/Config.hpp"
 
 #include <string.h>
 
@@ -27,16 +28,51 @@ namespace sw
 	extern TransparencyAntialiasing transparencyAntialiasing;
 	extern bool perspectiveCorrection;
 
+	extern bool backgroundCompilation;
+	extern int recompileThreshold;
+
 	bool precachePixel = false;
+	bool pipelineProfiling = false;
+	bool tiledRasterization = false;
+	bool halfSpaceRasterization = false;
+
+	class PixelRoutineTask : public RoutineCompiler::Task
+	{
+	public:
+		PixelRoutineTask(const PixelProcessor::State &state, const PixelShader *shader) : state(state), shader(shader ? new PixelShader(shader) : 0)
+		{
+		}
+
+		virtual ~PixelRoutineTask()
+		{
+			delete shader;
+		}
+
+		const PixelProcessor::State state;
+
+	protected:
+		virtual Routine *compile()
+		{
+			Rasterizer *generator = new QuadRasterizer(state, shader);
+			generator->generate(true);
+			Routine *routine = generator->getRoutine();
+			delete generator;
+
+			return routine;
+		}
+
+	private:
+		PixelShader *const shader;   // Private copy, the application may delete the original
+	};
 
 	unsigned int PixelProcessor::States::computeHash()
 	{
 		unsigned int *state = (unsigned int*)this;
-		unsigned int hash = 0;
+		unsigned int hash = 2166136261;   // FNV-1a on 32-bit words, well distributed for indexing the routine cache
 
 		for(int i = 0; i < sizeof(States) / 4; i++)
 		{
-			hash ^= state[i];
+			hash = (hash ^ state[i]) * 16777619;
 		}
 
 		return hash;
@@ -63,13 +99,17 @@ namespace sw
 		                             // Round to nearest LOD [0.7, 1.4]:  0.0
 		                             // Round to lowest LOD  [1.0, 2.0]:  0.5
 
+		routineCompiler = 0;
 		routineCache = 0;
 		setRoutineCacheSize(1024);
 	}
 
 	PixelProcessor::~PixelProcessor()
 	{
-		delete routineCache;
+		delete routineCompiler;
+		routineCompiler = 0;
+
+		RoutineCache<State>::release(routineCache);
 		routineCache = 0;
 	}
 
@@ -800,8 +840,16 @@ namespace sw
 
 	void PixelProcessor::setRoutineCacheSize(int cacheSize)
 	{
-		delete routineCache;
-		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precachePixel ? "sw-pixel" : 0);
+		if(routineCompiler)
+		{
+			routineCompiler->discard();
+		}
+
+		RoutineCache<State>::release(routineCache);
+
+		int size = clamp(cacheSize, 1, 65536);
+		const char *precache = precachePixel ? "sw-pixel" : 0;
+		routineCache = sharedRoutineCache ? RoutineCache<State>::share(size, precache, "sw-pixel") : new RoutineCache<State>(size, precache, "sw-pixel");
 	}
 
 	void PixelProcessor::setFogRanges(float start, float end)
@@ -821,19 +869,27 @@ namespace sw
 		fog.offset = replicate(fogOffset);
 	}
 
-	const PixelProcessor::State PixelProcessor::update() const
+	const PixelProcessor::State PixelProcessor::update(int clusterCount) const
 	{
 		State state;
 
 		if(context->pixelShader)
 		{
-			state.shaderID = context->pixelShader->getSerialID();
+			const uint64_t *shaderID = context->pixelShader->getID();
+
+			state.shaderID[0] = shaderID[0];
+			state.shaderID[1] = shaderID[1];
 		}
 		else
 		{
-			state.shaderID = 0;
+			state.shaderID[0] = 0;
+			state.shaderID[1] = 0;
 		}
 
+		state.profile = pipelineProfiling;
+		state.tiled = tiledRasterization || halfSpaceRasterization;   // Blocks are traversed within tiles
+		state.clusterCountLog2 = log2(clusterCount);
+		state.halfSpace = halfSpaceRasterization;
 		state.depthOverride = context->pixelShader && context->pixelShader->depthOverride();
 		state.shaderContainsKill = context->pixelShader ? context->pixelShader->containsKill() : false;
 		
@@ -874,6 +930,9 @@ namespace sw
 			state.quadLayoutDepthBuffer = context->depthStencil->getInternalFormat() != FORMAT_D32F_LOCKABLE &&
 			                              context->depthStencil->getInternalFormat() != FORMAT_D32FS8_TEXTURE &&
 			                              context->depthStencil->getInternalFormat() != FORMAT_D32FS8_SHADOW;
+
+			// Blocks are only traversed by the half-space rasterizer, and only the first sample is tracked
+			state.hiZ = state.halfSpace && !complementaryDepthBuffer && context->getMultiSampleCount() == 1 && context->getSuperSampleCount() == 1;
 		}
 
 		state.occlusionEnabled = context->occlusionEnabled;
@@ -932,6 +991,7 @@ namespace sw
 				if(context->pixelShader->usesSampler(i))
 				{
 					state.sampler[i] = context->sampler[i].samplerState();
+					state.samplerMethods[i] = context->pixelShader->getSamplerMethods();
 				}
 			}
 			else
@@ -939,6 +999,7 @@ namespace sw
 				if(i < 8 && state.textureStage[i].stageOperation != TextureStage::STAGE_DISABLE)
 				{
 					state.sampler[i] = context->sampler[i].samplerState();
+					state.samplerMethods[i] = state.textureStage[i].usesTexture ? 1 << SAMPLE_FIXED : 0;
 				}
 				else break;
 			}
@@ -1053,16 +1114,42 @@ namespace sw
 
 	Routine *PixelProcessor::routine(const State &state)
 	{
-		Routine *routine = routineCache->query(state);
+		if(routineCompiler)
+		{
+			while(RoutineCompiler::Task *task = routineCompiler->retrieve())
+			{
+				routineCache->replace(static_cast<PixelRoutineTask*>(task)->state, task->getRoutine());
+				delete task;
+			}
+		}
+
+		Routine *routine = routineCache->acquire(state);
 
+		// A miss still stalls the draw on a compile. With background compilation it is only an
+		// unoptimized compile, which takes less time; the optimized routine replaces it once hot.
 		if(!routine)
 		{
 			Rasterizer *generator = new QuadRasterizer(state, context->pixelShader);
-			generator->generate();
+			generator->generate(!backgroundCompilation);
 			routine = generator->getRoutine();
 			delete generator;
 
-			routineCache->add(state, routine);
+			routine = routineCache->acquire(state, routine);
+		}
+
+		if(!routine->isOptimized())
+		{
+			if(routine->use() == recompileThreshold)
+			{
+				if(!routineCompiler)
+				{
+					routineCompiler = new RoutineCompiler();
+				}
+
+				routineCompiler->queue(new PixelRoutineTask(state, context->pixelShader));
+			}
+
+			atomicIncrement(&profiler.unoptimizedDraws);
 		}
 
 		return routine;
@@ -14,6 +14,7 @@
 
 #include "Context.hpp"
 #include "RoutineCache.hpp"
+#include "RoutineCompiler.hpp"
 
 namespace sw
 {
@@ -29,7 +30,7 @@ namespace sw
 		{
 			unsigned int computeHash();
 
-			int shaderID;
+			uint64_t shaderID[2];   // Zero without a shader
 
 			bool depthOverride                        : 1;
 			bool shaderContainsKill                   : 1;
@@ -79,10 +80,14 @@ namespace sw
 			unsigned int multiSampleMask                      : 4;
 			TransparencyAntialiasing transparencyAntialiasing : BITS(TRANSPARENCY_LAST);
 			bool centroid                                     : 1;
+			bool profile                                      : 1;   // Accumulates cycles per pipeline stage
+			bool tiled                                        : 1;   // Rasterizes the cluster's screen tiles instead of its scanlines
+			unsigned int clusterCountLog2                     : 5;   // The scanline and tile strides are compiled in
+			bool halfSpace                                    : 1;   // Evaluates edge functions on blocks within the tiles
+			bool hiZ                                          : 1;   // Maintains the depth buffer's upper bound per block
 
 			LogicalOperation logicalOperation : BITS(LOGICALOP_LAST);
 
-			Sampler::State sampler[TEXTURE_IMAGE_UNITS];
 			TextureStage::State textureStage[8];
 
 			struct Interpolant
@@ -129,6 +134,10 @@ namespace sw
 			}
 
 			unsigned int hash;
+
+			// Not part of the routine key, sampling is done by calling the routines in the draw data
+			Sampler::State sampler[TEXTURE_IMAGE_UNITS];
+			unsigned char samplerMethods[TEXTURE_IMAGE_UNITS];   // Bit flags, by SamplerMethod
 		};
 
 		struct Stencil
@@ -286,8 +295,8 @@ namespace sw
 		virtual void setOcclusionEnabled(bool enable);
 
 	protected:
-		const State update() const;
-		Routine *routine(const State &state);
+		const State update(int clusterCount) const;   // Scanlines or tiles are interleaved among the clusters
+		Routine *routine(const State &state);   // Bound, for the draw call to unbind
 		void setRoutineCacheSize(int routineCacheSize);
 
 		// Shader constants
@@ -308,6 +317,7 @@ namespace sw
 		Context *const context;
 
 		RoutineCache<State> *routineCache;
+		RoutineCompiler *routineCompiler;
 	};
 }
 
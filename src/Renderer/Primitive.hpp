@@ -35,6 +35,8 @@ namespace sw
 	{
 		int yMin;
 		int yMax;
+		int xMin;   // Conservative horizontal range, for binning
+		int xMax;
 
 		float4 xQuad;
 		float4 yQuad;
@@ -67,9 +69,18 @@ namespace sw
 			unsigned short right;
 		};
 
-		Span outlineUnderflow;
-		Span outline[OUTLINE_RESOLUTION];
-		Span outlineOverflow;
+		Span *outline;   // Rows yMin - 1 to yMax, indexed by y, in the primitive unit's span buffer
+
+		struct EdgeGroup   // Four edge functions, covering pixel (x, y) where C + A * x + B * y >= 0
+		{
+			int4 A;
+			int4 B;
+			int4 C;      // Wraps around far from the edge
+			float4 Cf;   // Approximation of C, for the sign far from the edge
+		};
+
+		int edgeGroups;
+		EdgeGroup edge[4];   // For half-space rasterization, instead of the outline
 	};
 }
 
@@ -17,12 +17,17 @@
 #include "Constants.hpp"
 #include "Debug.hpp"
 
+#include <float.h>
+
 namespace sw
 {
 	extern bool veryEarlyDepthTest;
 	extern bool complementaryDepthBuffer;
 
-	extern int clusterCount;
+	static RValue<Int4> replicate(RValue<Int> x)
+	{
+		return Swizzle(Insert(Int4(0), x, 0), 0x00);
+	}
 
 	QuadRasterizer::QuadRasterizer(const PixelProcessor::State &state, const PixelShader *pixelShader) : PixelRoutine(state, pixelShader)
 	{
@@ -32,13 +37,16 @@ namespace sw
 	{
 	}
 
-	void QuadRasterizer::generate()
+	void QuadRasterizer::generate(bool optimize)
 	{
-		Function<Void, Pointer<Byte>, Int, Int, Pointer<Byte> > function;
+		Function<Void, Pointer<Byte>, Int, Int, Pointer<Byte> > function(RoutinePixel, optimize);
 		{
-			#if PERF_PROFILE
-				Long pixelTime = Ticks();
-			#endif
+			Long pixelTime;
+
+			if(state.profile)
+			{
+				pixelTime = Ticks();
+			}
 
 			Pointer<Byte> primitive(function.arg(0));
 			Int count(function.arg(1));
@@ -49,6 +57,14 @@ namespace sw
 			r.constants = *Pointer<Pointer<Byte> >(data + OFFSET(DrawData,constants));
 			r.cluster = cluster;
 			r.data = data;
+
+			if(state.profile)
+			{
+				for(int i = 0; i < PERF_TIMERS; i++)
+				{
+					r.cycles[i] = 0;
+				}
+			}
 			
 			Do
 			{
@@ -57,14 +73,26 @@ namespace sw
 				Int yMin = *Pointer<Int>(primitive + OFFSET(Primitive,yMin));
 				Int yMax = *Pointer<Int>(primitive + OFFSET(Primitive,yMax));
 
-				Int cluster2 = r.cluster + r.cluster;
-				yMin += clusterCount * 2 - 2 - cluster2;
-				yMin &= -clusterCount * 2;
-				yMin += cluster2;
-
-				If(yMin < yMax)
+				if(state.tiled)
 				{
-					rasterize(r, yMin, yMax);
+					rasterizeTiles(r, yMin, yMax);
+				}
+				else
+				{
+					const int clusterCount = 1 << state.clusterCountLog2;
+
+					Int cluster2 = r.cluster + r.cluster;
+					yMin += clusterCount * 2 - 2 - cluster2;
+					yMin &= -clusterCount * 2;
+					yMin += cluster2;
+
+					If(yMin < yMax)
+					{
+						Int xMin = 0;
+						Int xMax = 0;
+
+						rasterize(r, yMin, yMax, xMin, xMax);
+					}
 				}
 
 				primitive += sizeof(Primitive) * state.multiSample;
@@ -74,27 +102,70 @@ namespace sw
 
 			if(state.occlusionEnabled)
 			{
-				UInt clusterOcclusion = *Pointer<UInt>(data + OFFSET(DrawData,occlusion) + 4 * cluster);
+				Pointer<Byte> occlusion = *Pointer<Pointer<Byte> >(data + OFFSET(DrawData,occlusion));
+				UInt clusterOcclusion = *Pointer<UInt>(occlusion + 4 * cluster);
 				clusterOcclusion += r.occlusion;
-				*Pointer<UInt>(data + OFFSET(DrawData,occlusion) + 4 * cluster) = clusterOcclusion;
+				*Pointer<UInt>(occlusion + 4 * cluster) = clusterOcclusion;
 			}
 
-			#if PERF_PROFILE
+			if(state.profile)
+			{
 				r.cycles[PERF_PIXEL] = Ticks() - pixelTime;
 
 				for(int i = 0; i < PERF_TIMERS; i++)
 				{
-					*Pointer<Long>(data + OFFSET(DrawData,cycles[i]) + 8 * cluster) += r.cycles[i];
+					Pointer<Byte> cycles = *Pointer<Pointer<Byte> >(data + OFFSET(DrawData,cycles[i]));
+					*Pointer<Long>(cycles + 8 * cluster) += r.cycles[i];
 				}
-			#endif
+			}
 
 			Return();
 		}
 
-		routine = function(L"PixelRoutine_%0.8X", state.shaderID);
+		routine = function(L"PixelRoutine_%0.8X", (unsigned int)state.shaderID[0]);
+		routine->setPrecachable(!state.profile);   // Counters are in the process's own profiler
 	}
 
-	void QuadRasterizer::rasterize(Registers &r, Int &yMin, Int &yMax)
+	void QuadRasterizer::rasterizeTiles(Registers &r, Int &yMin, Int &yMax)
+	{
+		// Tile (x, y) belongs to cluster (x + y) % clusterCount, so neighboring tiles go to different clusters
+		const int clusterCount = 1 << state.clusterCountLog2;
+
+		Int xMin = *Pointer<Int>(r.primitive + OFFSET(Primitive,xMin));
+		Int xMax = *Pointer<Int>(r.primitive + OFFSET(Primitive,xMax));
+
+		Int tileX0 = xMin >> TILE_SIZE_LOG2;
+		Int tileX1 = (xMax - 1) >> TILE_SIZE_LOG2;
+		Int tileY0 = yMin >> TILE_SIZE_LOG2;
+		Int tileY1 = (yMax - 1) >> TILE_SIZE_LOG2;
+
+		For(Int tileY = tileY0, tileY <= tileY1, tileY++)
+		{
+			Int y0 = Max(yMin & 0xFFFFFFFE, tileY << TILE_SIZE_LOG2);   // Even, the outline above yMin is empty
+			Int y1 = Min(yMax, (tileY + 1) << TILE_SIZE_LOG2);
+
+			For(Int tileX = tileX0 + ((r.cluster - tileX0 - tileY) & (clusterCount - 1)), tileX <= tileX1, tileX += clusterCount)
+			{
+				Int x0 = tileX << TILE_SIZE_LOG2;
+				Int x1 = x0 + (1 << TILE_SIZE_LOG2);
+
+				if(state.halfSpace)
+				{
+					Int yMinTile = Max(yMin, tileY << TILE_SIZE_LOG2);
+					Int xMinTile = Max(xMin, x0);
+					Int xMaxTile = Min(xMax, x1);
+
+					rasterizeBlocks(r, yMinTile, y1, xMinTile, xMaxTile);
+				}
+				else
+				{
+					rasterize(r, y0, y1, x0, x1);
+				}
+			}
+		}
+	}
+
+	void QuadRasterizer::rasterize(Registers &r, Int &yMin, Int &yMax, Int &xMin, Int &xMax)
 	{
 		Pointer<Byte> cBuffer[4];
 		Pointer<Byte> zBuffer;
@@ -118,50 +189,54 @@ namespace sw
 			sBuffer = *Pointer<Pointer<Byte> >(r.data + OFFSET(DrawData,stencilBuffer)) + yMin * *Pointer<Int>(r.data + OFFSET(DrawData,stencilPitchB));
 		}
 
+		Pointer<Byte> outline[4];
+
+		for(unsigned int q = 0; q < state.multiSample; q++)
+		{
+			outline[q] = *Pointer<Pointer<Byte> >(r.primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline));
+		}
+
 		Int y = yMin;
 		
 		Do
 		{
-			Int x0a = Int(*Pointer<Short>(r.primitive + OFFSET(Primitive,outline->left) + (y + 0) * sizeof(Primitive::Span)));
-			Int x0b = Int(*Pointer<Short>(r.primitive + OFFSET(Primitive,outline->left) + (y + 1) * sizeof(Primitive::Span)));
+			Int x0a = Int(*Pointer<Short>(outline[0] + OFFSET(Primitive::Span,left) + (y + 0) * sizeof(Primitive::Span)));
+			Int x0b = Int(*Pointer<Short>(outline[0] + OFFSET(Primitive::Span,left) + (y + 1) * sizeof(Primitive::Span)));
 			Int x0 = Min(x0a, x0b);
 			
 			for(unsigned int q = 1; q < state.multiSample; q++)
 			{
-				x0a = Int(*Pointer<Short>(r.primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->left) + (y + 0) * sizeof(Primitive::Span)));
-				x0b = Int(*Pointer<Short>(r.primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->left) + (y + 1) * sizeof(Primitive::Span)));
+				x0a = Int(*Pointer<Short>(outline[q] + OFFSET(Primitive::Span,left) + (y + 0) * sizeof(Primitive::Span)));
+				x0b = Int(*Pointer<Short>(outline[q] + OFFSET(Primitive::Span,left) + (y + 1) * sizeof(Primitive::Span)));
 				x0 = Min(x0, Min(x0a, x0b));
 			}
 			
 			x0 &= 0xFFFFFFFE;
 
-			Int x1a = Int(*Pointer<Short>(r.primitive + OFFSET(Primitive,outline->right) + (y + 0) * sizeof(Primitive::Span)));
-			Int x1b = Int(*Pointer<Short>(r.primitive + OFFSET(Primitive,outline->right) + (y + 1) * sizeof(Primitive::Span)));
+			if(state.tiled)
+			{
+				x0 = Max(x0, xMin);
+			}
+
+			Int x1a = Int(*Pointer<Short>(outline[0] + OFFSET(Primitive::Span,right) + (y + 0) * sizeof(Primitive::Span)));
+			Int x1b = Int(*Pointer<Short>(outline[0] + OFFSET(Primitive::Span,right) + (y + 1) * sizeof(Primitive::Span)));
 			Int x1 = Max(x1a, x1b);
 
 			for(unsigned int q = 1; q < state.multiSample; q++)
 			{
-				x1a = Int(*Pointer<Short>(r.primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right) + (y + 0) * sizeof(Primitive::Span)));
-				x1b = Int(*Pointer<Short>(r.primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right) + (y + 1) * sizeof(Primitive::Span)));
+				x1a = Int(*Pointer<Short>(outline[q] + OFFSET(Primitive::Span,right) + (y + 0) * sizeof(Primitive::Span)));
+				x1b = Int(*Pointer<Short>(outline[q] + OFFSET(Primitive::Span,right) + (y + 1) * sizeof(Primitive::Span)));
 				x1 = Max(x1, Max(x1a, x1b));
 			}
 
-			Float4 yyyy = Float4(Float(y)) + *Pointer<Float4>(r.primitive + OFFSET(Primitive,yQuad), 16);
-
-			if(interpolateZ())
+			if(state.tiled)
 			{
-				for(unsigned int q = 0; q < state.multiSample; q++)
-				{
-					Float4 y = yyyy;
+				x1 = Min(x1, xMax);
+			}
 
-					if(state.multiSample > 1)
-					{
-						y -= *Pointer<Float4>(r.constants + OFFSET(Constants,Y) + q * sizeof(float4));
-					}
+			Float4 yyyy = Float4(Float(y)) + *Pointer<Float4>(r.primitive + OFFSET(Primitive,yQuad), 16);
 
-					r.Dz[q] = *Pointer<Float4>(r.primitive + OFFSET(Primitive,z.C), 16) + y * *Pointer<Float4>(r.primitive + OFFSET(Primitive,z.B), 16);
-				}
-			}
+			interpolateRowZ(r, yyyy);
 
 			if(veryEarlyDepthTest && state.multiSample == 1)
 			{
@@ -237,43 +312,14 @@ namespace sw
 
 			If(x0 < x1)
 			{
-				if(interpolateW())
-				{
-					r.Dw = *Pointer<Float4>(r.primitive + OFFSET(Primitive,w.C), 16) + yyyy * *Pointer<Float4>(r.primitive + OFFSET(Primitive,w.B), 16);
-				}
-
-				for(int interpolant = 0; interpolant < 10; interpolant++)
-				{
-					for(int component = 0; component < 4; component++)
-					{
-						if(state.interpolant[interpolant].component & (1 << component))
-						{
-							r.Dv[interpolant][component] = *Pointer<Float4>(r.primitive + OFFSET(Primitive,V[interpolant][component].C), 16);
-
-							if(!(state.interpolant[interpolant].flat & (1 << component)))
-							{
-								r.Dv[interpolant][component] += yyyy * *Pointer<Float4>(r.primitive + OFFSET(Primitive,V[interpolant][component].B), 16);
-							}
-						}
-					}
-				}
-
-				if(state.fog.component)
-				{
-					r.Df = *Pointer<Float4>(r.primitive + OFFSET(Primitive,f.C), 16);
-
-					if(!state.fog.flat)
-					{
-						r.Df += yyyy * *Pointer<Float4>(r.primitive + OFFSET(Primitive,f.B), 16);
-					}
-				}
+				interpolateRow(r, yyyy);
 
 				Short4 xLeft[4];
 				Short4 xRight[4];
 
 				for(unsigned int q = 0; q < state.multiSample; q++)
 				{
-					xLeft[q] = *Pointer<Short4>(r.primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline) + y * sizeof(Primitive::Span));
+					xLeft[q] = *Pointer<Short4>(outline[q] + y * sizeof(Primitive::Span));
 					xRight[q] = xLeft[q];
 
 					xLeft[q] = Swizzle(xLeft[q], 0xA0) - Short4(1, 2, 1, 2);
@@ -295,26 +341,335 @@ namespace sw
 				}
 			}
 
+			int rowShift = state.tiled ? 1 : 1 + state.clusterCountLog2;   // Tiles have consecutive rows, scanlines are interleaved
+
 			for(int index = 0; index < 4; index++)
 			{
 				if(state.colorWriteActive(index))
 				{
-					cBuffer[index] += *Pointer<Int>(r.data + OFFSET(DrawData,colorPitchB[index])) << (1 + sw::log2(clusterCount));   // FIXME: Precompute
+					cBuffer[index] += *Pointer<Int>(r.data + OFFSET(DrawData,colorPitchB[index])) << rowShift;   // FIXME: Precompute
 				}
 			}
 
 			if(state.depthTestActive)
 			{
-				zBuffer += *Pointer<Int>(r.data + OFFSET(DrawData,depthPitchB)) << (1 + sw::log2(clusterCount));   // FIXME: Precompute
+				zBuffer += *Pointer<Int>(r.data + OFFSET(DrawData,depthPitchB)) << rowShift;   // FIXME: Precompute
 			}
 
 			if(state.stencilActive)
 			{
-				sBuffer += *Pointer<Int>(r.data + OFFSET(DrawData,stencilPitchB)) << (1 + sw::log2(clusterCount));   // FIXME: Precompute
+				sBuffer += *Pointer<Int>(r.data + OFFSET(DrawData,stencilPitchB)) << rowShift;   // FIXME: Precompute
 			}
 
-			y += 2 * clusterCount;
+			y += 1 << rowShift;
 		}
 		Until(y >= yMax)
 	}
+
+	void QuadRasterizer::rasterizeBlocks(Registers &r, Int &yMin, Int &yMax, Int &xMin, Int &xMax)
+	{
+		const int size = 1 << BLOCK_SIZE_LOG2;
+		const int quads = size / 2;   // Per block row and column
+
+		Array<Int> coverage(quads * quads * 4);   // Per sample and quad of the block
+		Int edgeGroups = *Pointer<Int>(r.primitive + OFFSET(Primitive,edgeGroups));
+
+		Int4 xMin4 = replicate(xMin);
+		Int4 xMax4 = replicate(xMax);
+		Int4 yMin4 = replicate(yMin);
+		Int4 yMax4 = replicate(yMax);
+
+		// The upper bound of the block's depth only holds while the stored depth can't increase
+		bool decreasing = state.depthTestActive && (state.depthCompareMode == DEPTH_LESS || state.depthCompareMode == DEPTH_LESSEQUAL);
+		bool hiZTest = state.hiZ && decreasing && !state.stencilActive && !state.depthOverride;
+		bool hiZUpdate = hiZTest && state.depthWriteEnable && !state.alphaTestActive() && !state.shaderContainsKill && state.transparencyAntialiasing == TRANSPARENCY_NONE;
+		bool hiZInvalidate = state.hiZ && state.depthWriteEnable && !decreasing && !(state.depthTestActive && (state.depthCompareMode == DEPTH_EQUAL || state.depthCompareMode == DEPTH_NEVER));
+
+		For(Int y0 = yMin & -size, y0 < yMax, y0 += size)
+		{
+			For(Int x0 = xMin & -size, x0 < xMax, x0 += size)
+			{
+				Int samples = 0;   // Not rejected by any edge
+				Int partial[4];    // Edges crossing the block, four bits per group
+
+				Pointer<Byte> hiZ;
+				Bool occluded = false;
+				Float zMax;
+				Float margin;
+
+				if(hiZTest || hiZInvalidate)
+				{
+					hiZ = *Pointer<Pointer<Byte> >(r.data + OFFSET(DrawData,hiZ)) + (y0 >> BLOCK_SIZE_LOG2) * *Pointer<Int>(r.data + OFFSET(DrawData,hiZPitchB)) + (x0 >> BLOCK_SIZE_LOG2) * sizeof(float);
+				}
+
+				if(hiZTest)
+				{
+					Float A = *Pointer<Float>(r.primitive + OFFSET(Primitive,z.A));
+					Float B = *Pointer<Float>(r.primitive + OFFSET(Primitive,z.B));
+					Float C = *Pointer<Float>(r.primitive + OFFSET(Primitive,z.C));
+					Float x = Float(x0) + *Pointer<Float>(r.primitive + OFFSET(Primitive,xQuad));
+					Float y = Float(y0) + *Pointer<Float>(r.primitive + OFFSET(Primitive,yQuad));
+
+					// Extremes of the plane over the block's pixels, widened by the interpolation's rounding
+					Float z = C + A * x + B * y;
+					Float dx = A * Float(size - 1);
+					Float dy = B * Float(size - 1);
+					Float zMin = z + Min(dx, Float(0.0f)) + Min(dy, Float(0.0f));
+					zMax = z + Max(dx, Float(0.0f)) + Max(dy, Float(0.0f));
+					margin = (Abs(C) + Abs(A) * (Abs(x) + Float(size)) + Abs(B) * (Abs(y) + Float(size))) * Float(1.0f / (1 << 20));
+
+					if(state.depthCompareMode == DEPTH_LESS)
+					{
+						occluded = zMin - margin >= *Pointer<Float>(hiZ);
+					}
+					else
+					{
+						occluded = zMin - margin > *Pointer<Float>(hiZ);
+					}
+				}
+
+				If(!occluded)
+				{
+					for(unsigned int q = 0; q < state.multiSample; q++)
+					{
+						Pointer<Byte> edge = r.primitive + q * sizeof(Primitive) + OFFSET(Primitive,edge);
+						Int rejected = 0;
+						partial[q] = 0;
+
+						For(Int g = 0, g < edgeGroups, g++)
+						{
+							Int4 A = *Pointer<Int4>(edge + OFFSET(Primitive::EdgeGroup,A), 16);
+							Int4 B = *Pointer<Int4>(edge + OFFSET(Primitive::EdgeGroup,B), 16);
+							Int4 E = *Pointer<Int4>(edge + OFFSET(Primitive::EdgeGroup,C), 16) + A * replicate(x0) + B * replicate(y0);
+							Float4 Ef = *Pointer<Float4>(edge + OFFSET(Primitive::EdgeGroup,Cf), 16) + Float4(A) * Float4(Float(x0)) + Float4(B) * Float4(Float(y0));
+
+							// Near the edge the wrapped around value is exact. Further away the approximation's sign holds for the whole block.
+							Int4 near = CmpLT(Abs(Ef), Float4(536870912.0f));
+							Int4 minimum = E + (Min(A, Int4(0)) + Min(B, Int4(0))) * Int4(size - 1);
+							Int4 maximum = E + (Max(A, Int4(0)) + Max(B, Int4(0))) * Int4(size - 1);
+							Int4 inside = (near & CmpNLT(minimum, Int4(0))) | (~near & CmpNLT(Ef, Float4(0.0f)));
+							Int4 outside = (near & CmpLT(maximum, Int4(0))) | (~near & CmpLT(Ef, Float4(0.0f)));
+
+							rejected |= SignMask(outside);
+							partial[q] |= SignMask(~(inside | outside)) << (g << 2);
+
+							edge += sizeof(Primitive::EdgeGroup);
+						}
+
+						samples |= IfThenElse(rejected == 0, Int(1 << q), Int(0));
+					}
+				}
+
+				If(samples != 0)
+				{
+					Int crossing = partial[0];
+
+					for(unsigned int q = 1; q < state.multiSample; q++)
+					{
+						crossing |= partial[q];
+					}
+
+					Bool bounded = x0 >= xMin && x0 + size <= xMax && y0 >= yMin && y0 + size <= yMax;
+
+					Bool full = crossing == 0 && samples == Int((1 << state.multiSample) - 1) && bounded;
+
+					If(full)   // Fully covered, no edges to evaluate
+					{
+						for(unsigned int q = 0; q < state.multiSample; q++)
+						{
+							for(int k = 0; k < quads * quads; k++)
+							{
+								coverage[q * quads * quads + k] = 0x0000000F;
+							}
+						}
+					}
+					Else
+					{
+						Int bounds[quads * quads];   // Clipped to the primitive's range within the tile
+						Int4 yyyy = replicate(y0) + Int4(0, 0, 1, 1);
+
+						for(int j = 0; j < quads; j++)
+						{
+							Int4 rowMask = CmpNLT(yyyy, yMin4) & CmpLT(yyyy, yMax4);
+							Int4 xxxx = replicate(x0) + Int4(0, 1, 0, 1);
+
+							for(int i = 0; i < quads; i++)
+							{
+								bounds[j * quads + i] = SignMask(rowMask & CmpNLT(xxxx, xMin4) & CmpLT(xxxx, xMax4));
+								xxxx += Int4(2);
+							}
+
+							yyyy += Int4(2);
+						}
+
+						for(unsigned int q = 0; q < state.multiSample; q++)
+						{
+							Int sampleMask = -((samples >> q) & 1);
+
+							for(int k = 0; k < quads * quads; k++)
+							{
+								coverage[q * quads * quads + k] = bounds[k] & sampleMask;
+							}
+
+							Pointer<Byte> edge = r.primitive + q * sizeof(Primitive) + OFFSET(Primitive,edge);
+
+							For(Int g = 0, g < edgeGroups, g++)
+							{
+								Int bits = partial[q] >> (g << 2);
+
+								for(int l = 0; l < 4; l++)
+								{
+									If((bits & (1 << l)) != 0)   // Edges which don't cross the block leave the coverage unchanged
+									{
+										Int A = *Pointer<Int>(edge + OFFSET(Primitive::EdgeGroup,A) + l * sizeof(int));
+										Int B = *Pointer<Int>(edge + OFFSET(Primitive::EdgeGroup,B) + l * sizeof(int));
+										Int E = *Pointer<Int>(edge + OFFSET(Primitive::EdgeGroup,C) + l * sizeof(int)) + A * x0 + B * y0;
+
+										Int4 row = Insert(Insert(Insert(Insert(Int4(0), E, 0), E + A, 1), E + B, 2), E + A + B, 3);
+										Int4 stepX = replicate(A + A);
+										Int4 stepY = replicate(B + B);
+
+										for(int j = 0; j < quads; j++)
+										{
+											Int4 e = row;
+
+											for(int i = 0; i < quads; i++)
+											{
+												coverage[q * quads * quads + j * quads + i] = coverage[q * quads * quads + j * quads + i] & ~SignMask(e);
+												e += stepX;
+											}
+
+											row += stepY;
+										}
+									}
+								}
+
+								edge += sizeof(Primitive::EdgeGroup);
+							}
+						}
+					}
+
+					Int y = y0;
+
+					For(Int j = 0, j < quads, j++)
+					{
+						Pointer<Byte> cBuffer[4];
+						Pointer<Byte> zBuffer;
+						Pointer<Byte> sBuffer;
+
+						for(int index = 0; index < 4; index++)
+						{
+							if(state.colorWriteActive(index))
+							{
+								cBuffer[index] = *Pointer<Pointer<Byte> >(r.data + OFFSET(DrawData,colorBuffer[index])) + y * *Pointer<Int>(r.data + OFFSET(DrawData,colorPitchB[index]));
+							}
+						}
+
+						if(state.depthTestActive)
+						{
+							zBuffer = *Pointer<Pointer<Byte> >(r.data + OFFSET(DrawData,depthBuffer)) + y * *Pointer<Int>(r.data + OFFSET(DrawData,depthPitchB));
+						}
+
+						if(state.stencilActive)
+						{
+							sBuffer = *Pointer<Pointer<Byte> >(r.data + OFFSET(DrawData,stencilBuffer)) + y * *Pointer<Int>(r.data + OFFSET(DrawData,stencilPitchB));
+						}
+
+						Float4 yyyy = Float4(Float(y)) + *Pointer<Float4>(r.primitive + OFFSET(Primitive,yQuad), 16);
+
+						interpolateRowZ(r, yyyy);
+						interpolateRow(r, yyyy);
+
+						Int x = x0;
+
+						For(Int i = 0, i < quads, i++)
+						{
+							Int cMask[4];
+							Int covered = 0;
+
+							for(unsigned int q = 0; q < state.multiSample; q++)
+							{
+								cMask[q] = coverage[q * quads * quads + j * quads + i];
+								covered |= cMask[q];
+							}
+
+							If(covered != 0)
+							{
+								quad(r, cBuffer, zBuffer, sBuffer, cMask, x, y);
+							}
+
+							x += 2;
+						}
+
+						y += 2;
+					}
+
+					if(hiZUpdate)
+					{
+						If(full)   // Every pixel now holds at most the plane's depth
+						{
+							*Pointer<Float>(hiZ) = Min(*Pointer<Float>(hiZ), zMax + margin);
+						}
+					}
+
+					if(hiZInvalidate)
+					{
+						*Pointer<Float>(hiZ) = Float(FLT_MAX);
+					}
+				}
+			}
+		}
+	}
+
+	void QuadRasterizer::interpolateRowZ(Registers &r, Float4 &yyyy)
+	{
+		if(interpolateZ())
+		{
+			for(unsigned int q = 0; q < state.multiSample; q++)
+			{
+				Float4 y = yyyy;
+
+				if(state.multiSample > 1)
+				{
+					y -= *Pointer<Float4>(r.constants + OFFSET(Constants,Y) + q * sizeof(float4));
+				}
+
+				r.Dz[q] = *Pointer<Float4>(r.primitive + OFFSET(Primitive,z.C), 16) + y * *Pointer<Float4>(r.primitive + OFFSET(Primitive,z.B), 16);
+			}
+		}
+	}
+
+	void QuadRasterizer::interpolateRow(Registers &r, Float4 &yyyy)
+	{
+		if(interpolateW())
+		{
+			r.Dw = *Pointer<Float4>(r.primitive + OFFSET(Primitive,w.C), 16) + yyyy * *Pointer<Float4>(r.primitive + OFFSET(Primitive,w.B), 16);
+		}
+
+		for(int interpolant = 0; interpolant < 10; interpolant++)
+		{
+			for(int component = 0; component < 4; component++)
+			{
+				if(state.interpolant[interpolant].component & (1 << component))
+				{
+					r.Dv[interpolant][component] = *Pointer<Float4>(r.primitive + OFFSET(Primitive,V[interpolant][component].C), 16);
+
+					if(!(state.interpolant[interpolant].flat & (1 << component)))
+					{
+						r.Dv[interpolant][component] += yyyy * *Pointer<Float4>(r.primitive + OFFSET(Primitive,V[interpolant][component].B), 16);
+					}
+				}
+			}
+		}
+
+		if(state.fog.component)
+		{
+			r.Df = *Pointer<Float4>(r.primitive + OFFSET(Primitive,f.C), 16);
+
+			if(!state.fog.flat)
+			{
+				r.Df += yyyy * *Pointer<Float4>(r.primitive + OFFSET(Primitive,f.B), 16);
+			}
+		}
+	}
 }
@@ -25,9 +25,13 @@ namespace sw
 		virtual ~QuadRasterizer();
 
 	private:
-		void generate();
+		void generate(bool optimize);
 
-		void rasterize(Registers &r, Int &yMin, Int &yMax);
+		void rasterizeTiles(Registers &r, Int &yMin, Int &yMax);
+		void rasterize(Registers &r, Int &yMin, Int &yMax, Int &xMin, Int &xMax);   // Horizontal range only applies to tiles
+		void rasterizeBlocks(Registers &r, Int &yMin, Int &yMax, Int &xMin, Int &xMax);
+		void interpolateRowZ(Registers &r, Float4 &yyyy);
+		void interpolateRow(Registers &r, Float4 &yyyy);
 	};
 }
 
@@ -26,7 +26,7 @@ namespace sw
 
 		virtual ~Rasterizer();
 
-		virtual void generate() = 0;
+		virtual void generate(bool optimize = true) = 0;
 		Routine *getRoutine();
 
 	protected:
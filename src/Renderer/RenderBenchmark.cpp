@@ -0,0 +1,241 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+
+// Measures how rendering scales with the renderer's thread count, with scanline-interleaved and
+// with tiled rasterization. Each frame clears, then draws layers of small triangles back to front
+// with depth testing, so every pixel of every layer is shaded. Renderers are configured through a
+// SwiftShader.ini written to a temporary directory.
+//
+// Bandwidth is an estimate of 12 bytes per pixel: a color write and a depth read and write.
+//
+// Usage: swrenderbench [frames] [max threads]
+
+#include "Renderer.hpp"
+#include "Context.hpp"
+#include "Surface.hpp"
+#include "Stream.hpp"
+
+#include "CPUID.hpp"
+#include "Timer.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+extern bool disableServer;
+
+using namespace sw;
+
+enum
+{
+	WIDTH = 1024,
+	HEIGHT = 768,
+	GRID = 16,     // Quads per row and column of a layer
+	LAYERS = 8
+};
+
+const int quadCount = GRID * GRID * LAYERS;
+const int vertexCount = quadCount * 6;
+
+static void createGeometry(float (*vertex)[4])
+{
+	int v = 0;
+
+	for(int layer = 0; layer < LAYERS; layer++)
+	{
+		float z = 0.9f - 0.8f * layer / LAYERS;   // Back to front, so every layer passes the depth test
+
+		for(int y = 0; y < GRID; y++)
+		{
+			for(int x = 0; x < GRID; x++)
+			{
+				float x0 = -1.0f + 2.0f * x / GRID;
+				float y0 = -1.0f + 2.0f * y / GRID;
+				float x1 = -1.0f + 2.0f * (x + 1) / GRID;
+				float y1 = -1.0f + 2.0f * (y + 1) / GRID;
+
+				const float corner[6][2] = {{x0, y0}, {x1, y0}, {x0, y1}, {x0, y1}, {x1, y0}, {x1, y1}};
+
+				for(int i = 0; i < 6; i++)
+				{
+					vertex[v][0] = corner[i][0];
+					vertex[v][1] = corner[i][1];
+					vertex[v][2] = z;
+					vertex[v][3] = 1.0f;
+					v++;
+				}
+			}
+		}
+	}
+}
+
+static bool writeConfiguration(int threads, bool tiled)
+{
+	FILE *file = fopen("SwiftShader.ini", "w");
+
+	if(!file)
+	{
+		return false;
+	}
+
+	fprintf(file, "[Processor]\nThreadCount=%d\nTiledRasterization=%d\n", threads, tiled ? 1 : 0);
+	fclose(file);
+
+	return true;
+}
+
+// Returns the frame rate, or 0 if the rendered image is wrong
+static double run(int frames, const float (*vertex)[4], Surface *renderTarget, Surface *depthBuffer)
+{
+	Context *context = new Context();
+	Renderer *renderer = new Renderer(context, Direct3D, false);
+
+	renderer->setRenderTarget(0, renderTarget);
+	renderer->setDepthStencil(depthBuffer);
+
+	Viewport viewport = {0, 0, WIDTH, HEIGHT, 0, 1};
+	renderer->setViewport(viewport);
+	renderer->setScissor(Rect(0, 0, WIDTH, HEIGHT));
+
+	renderer->setModelMatrix(Matrix(1));
+	renderer->setViewMatrix(Matrix(1));
+	renderer->setProjectionMatrix(Matrix(1));
+	renderer->setLightingEnable(false);
+	renderer->setCullMode(CULL_NONE);
+	renderer->setDepthBufferEnable(true);
+	renderer->setDepthCompare(DEPTH_LESS);
+	renderer->setDepthBias(0.0f);   // Not initialized by the renderer
+	renderer->setSlopeDepthBias(0.0f);
+
+	renderer->resetInputStreams(false);
+	renderer->setIndexBuffer(0);   // Not initialized by the context
+	renderer->setInputStream(Position, Stream(0, vertex, 4 * sizeof(float)).define(STREAMTYPE_FLOAT, 4));
+
+	double start = 0;
+
+	for(int frame = -1; frame < frames; frame++)   // The first frame compiles the routines and isn't timed
+	{
+		if(frame == 0)
+		{
+			start = Timer::seconds();
+		}
+
+		renderTarget->clearColorBuffer(0xFF000000, 0xF, 0, 0, WIDTH, HEIGHT);
+		depthBuffer->clearDepthBuffer(1.0f, 0, 0, WIDTH, HEIGHT);
+
+		renderer->draw(DRAW_TRIANGLELIST, 0, quadCount * 2);
+		renderer->synchronize();
+	}
+
+	double rate = frames / (Timer::seconds() - start);
+
+	delete renderer;
+	delete context;
+
+	// The last layer drawn is white across the whole target
+	unsigned int *color = (unsigned int*)renderTarget->lockInternal(0, 0, 0, LOCK_READONLY, PUBLIC);
+	int pitch = renderTarget->getInternalPitchP();
+	bool correct = true;
+
+	for(int y = 0; y < HEIGHT; y++)
+	{
+		for(int x = 0; x < WIDTH; x++)
+		{
+			correct = correct && color[y * pitch + x] == 0xFFFFFFFF;
+		}
+	}
+
+	renderTarget->unlockInternal();
+
+	return correct ? rate : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int frames = argc > 1 ? atoi(argv[1]) : 50;
+	int maxThreads = argc > 2 ? atoi(argv[2]) : CPUID::coreCount();
+
+	if(frames < 1 || maxThreads < 1 || maxThreads > 64)
+	{
+		fprintf(stderr, "Usage: %s [frames] [max threads, up to 64]\n", argv[0]);
+
+		return 1;
+	}
+
+	// Keep the configuration out of the working directory, and don't start the configuration server
+	char directory[] = "/tmp/swrenderbenchXXXXXX";
+
+	if(!mkdtemp(directory) || chdir(directory) != 0)
+	{
+		fprintf(stderr, "Can't create a temporary directory\n");
+
+		return 1;
+	}
+
+	::disableServer = true;
+
+	float (*vertex)[4] = new float[vertexCount][4];
+	createGeometry(vertex);
+
+	Surface *renderTarget = new Surface(0, WIDTH, HEIGHT, 1, FORMAT_A8R8G8B8, false, true);
+	Surface *depthBuffer = new Surface(0, WIDTH, HEIGHT, 1, FORMAT_D24S8, false, true);
+
+	const double pixels = (double)WIDTH * HEIGHT * LAYERS;   // Shaded per frame
+
+	printf("%dx%d, %d layers of %d triangles\n\n", WIDTH, HEIGHT, LAYERS, GRID * GRID * 2);
+	printf("                   Interleaved                        Tiled\n");
+	printf("Threads  Frames/s  Mpixels/s  GB/s (est.)  Frames/s  Mpixels/s  GB/s (est.)\n");
+
+	int result = 0;
+
+	for(int threads = 1; threads <= maxThreads && result == 0; threads *= 2)
+	{
+		if(threads * 2 > maxThreads)
+		{
+			threads = maxThreads;   // Powers of two, and the maximum
+		}
+
+		printf("%7d", threads);
+
+		for(int tiled = 0; tiled < 2; tiled++)
+		{
+			double rate = 0;
+
+			if(writeConfiguration(threads, tiled != 0))
+			{
+				rate = run(frames, vertex, renderTarget, depthBuffer);
+			}
+
+			if(rate == 0)
+			{
+				fprintf(stderr, "\n%s rendering with %d threads failed\n", tiled ? "Tiled" : "Interleaved", threads);
+				result = 1;
+
+				break;
+			}
+
+			printf("  %8.1f  %9.1f  %11.2f", rate, rate * pixels / 1.0e6, rate * pixels * 12 / 1.0e9);
+		}
+
+		printf("\n");
+	}
+
+	delete depthBuffer;
+	delete renderTarget;
+	delete[] vertex;
+
+	unlink("SwiftShader.ini");
+	chdir("/");
+	rmdir(directory);
+
+	return result;
+}
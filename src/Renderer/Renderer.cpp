@@ -57,11 +57,16 @@ namespace sw
 	extern bool precacheVertex;
 	extern bool precacheSetup;
 	extern bool precachePixel;
+	extern bool precacheSampler;
+	extern bool pipelineProfiling;
+	extern bool tiledRasterization;
+	extern bool halfSpaceRasterization;
+	extern bool backgroundCompilation;
+	extern int recompileThreshold;
+	extern bool sharedRoutineCache;
+	extern int routineCacheBudget;
 
 	int batchSize = 128;
-	int threadCount = 1;
-	int unitCount = 1;
-	int clusterCount = 1;
 
 	TranscendentalPrecision logPrecision = ACCURATE;
 	TranscendentalPrecision expPrecision = ACCURATE;
@@ -75,7 +80,7 @@ namespace sw
 		int threadIndex;
 	};
 
-	DrawCall::DrawCall()
+	DrawCall::DrawCall(int clusterCount)
 	{
 		queries = 0;
 
@@ -91,12 +96,26 @@ namespace sw
 
 		data = (DrawData*)allocate(sizeof(DrawData));
 		data->constants = &constants;
+
+		data->occlusion = (unsigned int*)allocate(clusterCount * sizeof(unsigned int));
+
+		for(int i = 0; i < PERF_TIMERS; i++)
+		{
+			data->cycles[i] = (int64_t*)allocate(clusterCount * sizeof(int64_t));
+		}
 	}
 
 	DrawCall::~DrawCall()
 	{
 		delete queries;
 
+		deallocate(data->occlusion);
+
+		for(int i = 0; i < PERF_TIMERS; i++)
+		{
+			deallocate(data->cycles[i]);
+		}
+
 		deallocate(data);
 	}
 
@@ -117,50 +136,43 @@ namespace sw
 		updateProjectionMatrix = true;
 		updateClipPlanes = true;
 
+		// Sized for the thread count when the threads get started
+		vertexTask = 0;
+		worker = 0;
+		resume = 0;
+		suspend = 0;
+		task = 0;
+		taskQueue = 0;
+		triangleBatch = 0;
+		spanBuffer = 0;
+		spanBufferSize = 0;
+		primitiveBatch = 0;
+		binCount = 0;
+		bin = 0;
+		primitiveProgress = 0;
+		pixelProgress = 0;
+
 		#if PERF_HUD
-			resetTimers();
+			vertexTime = 0;
+			setupTime = 0;
+			pixelTime = 0;
 		#endif
 
-		for(int i = 0; i < 16; i++)
-		{
-			vertexTask[i] = 0;
-
-			worker[i] = 0;
-			resume[i] = 0;
-			suspend[i] = 0;
-		}
-
+		threadCount = 1;
+		unitCount = 1;
+		clusterCount = 1;
 		threadsAwake = 0;
 		resumeApp = new Event();
 
+		// Draw calls created later have all their constants marked dirty
+		drawCallCount = 0;
+		drawCount = 0;
+		drawCall = 0;
+		drawList = 0;
+
 		currentDraw = 0;
 		nextDraw = 0;
 
-		qHead = 0;
-		qSize = 0;
-
-		for(int i = 0; i < 16; i++)
-		{
-			triangleBatch[i] = 0;
-			primitiveBatch[i] = 0;
-		}
-
-		for(int draw = 0; draw < DRAW_COUNT; draw++)
-		{
-			drawCall[draw] = new DrawCall();
-			drawList[draw] = drawCall[draw];
-		}
-
-		for(int unit = 0; unit < 16; unit++)
-		{
-			primitiveProgress[unit].init();
-		}
-
-		for(int cluster = 0; cluster < 16; cluster++)
-		{
-			pixelProgress[cluster].init();
-		}
-
 		clipFlags = 0;
 
 		swiftConfig = new SwiftConfig(disableServer);
@@ -179,11 +191,14 @@ namespace sw
 		terminateThreads();
 		delete resumeApp;
 
-		for(int draw = 0; draw < DRAW_COUNT; draw++)
+		for(int draw = 0; draw < drawCount; draw++)
 		{
 			delete drawCall[draw];
 		}
 
+		delete[] drawCall;
+		delete[] drawList;
+
 		delete swiftConfig;
 	}
 
@@ -234,7 +249,7 @@ namespace sw
 			{
 				vertexState = VertexProcessor::update();
 				setupState = SetupProcessor::update();
-				pixelState = PixelProcessor::update();
+				pixelState = PixelProcessor::update(clusterCount);
 
 				vertexRoutine = VertexProcessor::routine(vertexState);
 				setupRoutine = SetupProcessor::routine(setupState);
@@ -276,12 +291,12 @@ namespace sw
 
 			do
 			{
-				for(int i = 0; i < DRAW_COUNT; i++)
+				for(int i = 0; i < drawCount; i++)
 				{
 					if(drawCall[i]->references == -1)
 					{
 						draw = drawCall[i];
-						drawList[nextDraw % DRAW_COUNT] = draw;
+						drawList[nextDraw % drawCount] = draw;
 
 						break;
 					}
@@ -309,10 +324,6 @@ namespace sw
 			draw->drawType = drawType;
 			draw->batchSize = batch;
 
-			vertexRoutine->bind();
-			setupRoutine->bind();
-			pixelRoutine->bind();
-
 			draw->vertexRoutine = vertexRoutine;
 			draw->setupRoutine = setupRoutine;
 			draw->pixelRoutine = pixelRoutine;
@@ -321,6 +332,8 @@ namespace sw
 			draw->pixelPointer = (PixelProcessor::RoutinePointer)pixelRoutine->getEntry();
 			draw->setupPrimitives = setupPrimitives;
 			draw->setupState = setupState;
+			draw->profile = pixelState.profile;
+			draw->tiled = pixelState.tiled;
 
 			for(int i = 0; i < VERTEX_ATTRIBUTES; i++)
 			{
@@ -344,6 +357,23 @@ namespace sw
 			for(int sampler = 0; sampler < TOTAL_IMAGE_UNITS; sampler++)
 			{
 				draw->texture[sampler] = 0;
+
+				const bool pixelSampler = sampler < TEXTURE_IMAGE_UNITS;
+				const Sampler::State &samplerState = pixelSampler ? pixelState.sampler[sampler] : vertexState.samplerState[sampler - TEXTURE_IMAGE_UNITS];
+				unsigned int samplerMethods = pixelSampler ? pixelState.samplerMethods[sampler] : vertexState.samplerMethods[sampler - TEXTURE_IMAGE_UNITS];
+
+				for(unsigned int method = 0; method < SAMPLER_METHOD_COUNT; method++)
+				{
+					Routine *routine = 0;
+
+					if(samplerMethods & (1 << method))
+					{
+						routine = Sampler::routine(samplerState, (SamplerMethod)method);
+						data->samplerRoutine[sampler][method] = routine->getEntry();
+					}
+
+					draw->samplerRoutine[sampler][method] = routine;
+				}
 			}
 
 			for(int sampler = 0; sampler < TEXTURE_IMAGE_UNITS; sampler++)
@@ -487,7 +517,8 @@ namespace sw
 				}
 			}
 
-			#if PERF_PROFILE
+			if(pixelState.profile)
+			{
 				for(int cluster = 0; cluster < clusterCount; cluster++)
 				{
 					for(int i = 0; i < PERF_TIMERS; i++)
@@ -495,7 +526,7 @@ namespace sw
 						data->cycles[i][cluster] = 0;
 					}
 				}
-			#endif
+			}
 
 			// Viewport
 			{
@@ -571,6 +602,11 @@ namespace sw
 
 					if(draw->renderTarget[index])
 					{
+						if(!pixelState.tiled)   // Scanlines of a tile are rendered by all clusters
+						{
+							context->renderTarget[index]->touchTiles();
+						}
+
 						data->colorBuffer[index] = (unsigned int*)context->renderTarget[index]->lockInternal(0, 0, q * ms, LOCK_READWRITE, MANAGED);
 						data->colorPitchB[index] = context->renderTarget[index]->getInternalPitchB();
 						data->colorSliceB[index] = context->renderTarget[index]->getInternalSliceB();
@@ -581,10 +617,32 @@ namespace sw
 
 				if(draw->depthStencil)
 				{
+					if(!pixelState.tiled)
+					{
+						context->depthStencil->touchTiles();
+					}
+
+					if(!pixelState.hiZ && context->depthWriteActive())
+					{
+						DepthCompareMode depthCompareMode = context->depthCompareMode;
+
+						// Other depth tests can raise the stored depth beyond the bound
+						if(complementaryDepthBuffer || (depthCompareMode != DEPTH_LESS && depthCompareMode != DEPTH_LESSEQUAL && depthCompareMode != DEPTH_EQUAL && depthCompareMode != DEPTH_NEVER))
+						{
+							context->depthStencil->discardHiZ();   // Before locking it for this draw
+						}
+					}
+
 					data->depthBuffer = (float*)context->depthStencil->lockInternal(0, 0, q * ms, LOCK_READWRITE, MANAGED);
 					data->depthPitchB = context->depthStencil->getInternalPitchB();
 					data->depthSliceB = context->depthStencil->getInternalSliceB();
 
+					if(pixelState.hiZ)
+					{
+						data->hiZ = context->depthStencil->getHiZ();
+						data->hiZPitchB = context->depthStencil->getHiZPitchB();
+					}
+
 					data->stencilBuffer = (unsigned char*)context->depthStencil->lockStencil(q * ms, MANAGED);
 					data->stencilPitchB = context->depthStencil->getStencilPitchB();
 					data->stencilSliceB = context->depthStencil->getStencilSliceB();
@@ -632,6 +690,8 @@ namespace sw
 		}
 
 		renderer->threadLoop(threadIndex);
+
+		Nucleus::releaseThread();
 	}
 
 	void Renderer::threadLoop(int threadIndex)
@@ -654,9 +714,11 @@ namespace sw
 		}
 	}
 
-	void Renderer::findAvailableTasks()
+	int Renderer::findAvailableTasks(int threadIndex)
 	{
-		// Find pixel tasks
+		int queued = 0;
+
+		// Find pixel tasks missed by the threads which completed primitives or pixels
 		for(int cluster = 0; cluster < clusterCount; cluster++)
 		{
 			if(!pixelProgress[cluster].executing)
@@ -665,23 +727,12 @@ namespace sw
 				{
 					if(primitiveProgress[unit].references > 0)   // Contains processed primitives
 					{
-						if(pixelProgress[cluster].drawCall == primitiveProgress[unit].drawCall)
+						if(claimCluster(cluster, primitiveProgress[unit].drawCall, primitiveProgress[unit].firstPrimitive))   // Previous primitives have been rendered
 						{
-							if(pixelProgress[cluster].processedPrimitives == primitiveProgress[unit].firstPrimitive)   // Previous primitives have been rendered
-							{
-								Task &task = taskQueue[qHead];
-								task.type = Task::PIXELS;
-								task.primitiveUnit = unit;
-								task.pixelCluster = cluster;
-
-								pixelProgress[cluster].executing = true;
-
-								// Commit to the task queue
-								qHead = (qHead + 1) % 32;
-								qSize++;
+							queueTask(Task::PIXELS, unit, cluster, threadIndex);
+							queued++;
 
-								break;
-							}
+							break;
 						}
 					}
 				}
@@ -691,12 +742,12 @@ namespace sw
 		// Find primitive tasks
 		if(currentDraw == nextDraw)
 		{
-			return;   // No more primitives to process
+			return queued;   // No more primitives to process
 		}
 
 		for(int unit = 0; unit < unitCount; unit++)
 		{
-			DrawCall *draw = drawList[currentDraw % DRAW_COUNT];
+			DrawCall *draw = drawList[currentDraw % drawCount];
 
 			if(draw->primitive >= draw->count)
 			{
@@ -704,10 +755,10 @@ namespace sw
 
 				if(currentDraw == nextDraw)
 				{
-					return;   // No more primitives to process
+					return queued;   // No more primitives to process
 				}
 
-				draw = drawList[currentDraw % DRAW_COUNT];
+				draw = drawList[currentDraw % drawCount];
 			}
 
 			if(!primitiveProgress[unit].references)   // Task not already being executed and not still in use by a pixel unit
@@ -716,56 +767,55 @@ namespace sw
 				int count = draw->count;
 				int batch = draw->batchSize;
 
+				primitiveProgress[unit].sequence++;
+				primitiveProgress[unit].references = -1;
 				primitiveProgress[unit].drawCall = currentDraw;
 				primitiveProgress[unit].firstPrimitive = primitive;
 				primitiveProgress[unit].primitiveCount = count - primitive >= batch ? batch : count - primitive;
+				primitiveProgress[unit].sequence++;
 
 				draw->primitive += batch;
 
-				Task &task = taskQueue[qHead];
-				task.type = Task::PRIMITIVES;
-				task.primitiveUnit = unit;
+				queueTask(Task::PRIMITIVES, unit, 0, threadIndex);
+				queued++;
 
-				primitiveProgress[unit].references = -1;
+				if(draw->primitive >= draw->count)
+				{
+					currentDraw++;   // Right away, the draw call's slot gets reused once its pixels are done
 
-				// Commit to the task queue
-				qHead = (qHead + 1) % 32;
-				qSize++;
+					if(currentDraw == nextDraw)
+					{
+						return queued;   // No more primitives to process
+					}
+				}
 			}
 		}
+
+		return queued;
 	}
 
 	void Renderer::scheduleTask(int threadIndex)
 	{
-		schedulerMutex.lock();
-
-		if((int)qSize < threadCount - threadsAwake + 1)
+		if(taskQueue[threadIndex].pop(task[threadIndex]))
 		{
-			findAvailableTasks();
+			return;
 		}
 
-		if(qSize != 0)
+		for(int i = 1; i < threadCount; i++)
 		{
-			task[threadIndex] = taskQueue[(qHead - qSize) % 32];
-			qSize--;
-
-			if(threadsAwake != threadCount)
+			if(taskQueue[(threadIndex + i) % threadCount].steal(task[threadIndex]))
 			{
-				int wakeup = qSize - threadsAwake + 1;
+				return;
+			}
+		}
 
-				for(int i = 0; i < threadCount && wakeup > 0; i++)
-				{
-					if(task[i].type == Task::SUSPEND)
-					{
-						suspend[i]->wait();
-						task[i].type = Task::RESUME;
-						resume[i]->signal();
+		schedulerMutex.lock();
 
-						threadsAwake++;
-						wakeup--;
-					}
-				}
-			}
+		int queued = findAvailableTasks(threadIndex);
+
+		if(taskQueue[threadIndex].pop(task[threadIndex]))
+		{
+			resumeThreads(queued - 1);   // To steal the remaining tasks
 		}
 		else
 		{
@@ -777,12 +827,179 @@ namespace sw
 		schedulerMutex.unlock();
 	}
 
+	void Renderer::queuePixelTasks(int unit, int threadIndex)
+	{
+		int drawCall = primitiveProgress[unit].drawCall;
+		int firstPrimitive = primitiveProgress[unit].firstPrimitive;
+
+		// Publish the primitives before checking which clusters wait for them. Clusters completing
+		// concurrently release themselves before looking for their next primitives, so either finds the other.
+		atomicExchange(&primitiveProgress[unit].references, clusterCount);
+
+		int queued = 0;
+
+		for(int cluster = 0; cluster < clusterCount; cluster++)
+		{
+			if(claimCluster(cluster, drawCall, firstPrimitive))
+			{
+				queueTask(Task::PIXELS, unit, cluster, threadIndex);
+				queued++;
+			}
+		}
+
+		if(queued > 1 && threadsAwake != threadCount)
+		{
+			schedulerMutex.lock();
+			resumeThreads(queued - 1);
+			schedulerMutex.unlock();
+		}
+	}
+
+	void Renderer::queueNextPixelTask(int cluster, int threadIndex)
+	{
+		int drawCall = pixelProgress[cluster].drawCall;
+		int firstPrimitive = pixelProgress[cluster].processedPrimitives;
+
+		atomicExchange(&pixelProgress[cluster].executing, 0);
+
+		int unit = findPrimitiveUnit(drawCall, firstPrimitive);
+
+		if(unit >= 0 && claimCluster(cluster, drawCall, firstPrimitive))
+		{
+			queueTask(Task::PIXELS, unit, cluster, threadIndex);
+		}
+	}
+
+	bool Renderer::claimCluster(int cluster, int drawCall, int firstPrimitive)
+	{
+		PixelProgress &progress = pixelProgress[cluster];
+
+		if(progress.executing || progress.drawCall != drawCall || progress.processedPrimitives != firstPrimitive)
+		{
+			return false;
+		}
+
+		if(atomicCompareExchange(&progress.executing, 1, 0) != 0)
+		{
+			return false;   // Claimed by another thread
+		}
+
+		if(progress.drawCall != drawCall || progress.processedPrimitives != firstPrimitive)   // Rendered by another thread in the meantime
+		{
+			atomicExchange(&progress.executing, 0);
+
+			return false;
+		}
+
+		return true;
+	}
+
+	int Renderer::findPrimitiveUnit(int drawCall, int firstPrimitive)
+	{
+		for(int unit = 0; unit < unitCount; unit++)
+		{
+			PrimitiveProgress &progress = primitiveProgress[unit];
+			int sequence = progress.sequence;
+
+			if(!(sequence & 1) && progress.references > 0 && progress.drawCall == drawCall && progress.firstPrimitive == firstPrimitive && progress.sequence == sequence)
+			{
+				return unit;
+			}
+		}
+
+		return -1;
+	}
+
+	void Renderer::queueTask(Task::Type type, int unit, int cluster, int threadIndex)
+	{
+		Task task;
+		task.type = type;
+		task.primitiveUnit = unit;
+		task.pixelCluster = cluster;
+
+		taskQueue[threadIndex].push(task);
+	}
+
+	void Renderer::resumeThreads(int count)
+	{
+		for(int i = 0; i < threadCount && count > 0; i++)
+		{
+			if(task[i].type == Task::SUSPEND)
+			{
+				suspend[i]->wait();
+				task[i].type = Task::RESUME;
+				resume[i]->signal();
+
+				threadsAwake++;
+				count--;
+			}
+		}
+	}
+
+	void Renderer::TaskQueue::push(const Task &newTask)
+	{
+		mutex.lock();
+
+		ASSERT(bottom - top < size);
+		task[bottom & (size - 1)] = newTask;
+		bottom++;
+
+		mutex.unlock();
+	}
+
+	bool Renderer::TaskQueue::pop(Task &oldTask)
+	{
+		if(top == bottom)
+		{
+			return false;
+		}
+
+		mutex.lock();
+
+		bool available = top != bottom;
+
+		if(available)
+		{
+			bottom--;
+			oldTask = task[bottom & (size - 1)];
+		}
+
+		mutex.unlock();
+
+		return available;
+	}
+
+	bool Renderer::TaskQueue::steal(Task &oldTask)
+	{
+		if(top == bottom)
+		{
+			return false;
+		}
+
+		mutex.lock();
+
+		bool available = top != bottom;
+
+		if(available)
+		{
+			oldTask = task[top & (size - 1)];
+			top++;
+		}
+
+		mutex.unlock();
+
+		return available;
+	}
+
 	void Renderer::executeTask(int threadIndex)
 	{
 		#if PERF_HUD
 			int64_t startTick = Timer::ticks();
 		#endif
 
+		bool profileRoutines = optimizationProfiling;   // Execution time per routine type, including the surrounding work
+		int64_t routineTick = profileRoutines ? Timer::ticks() : 0;
+
 		switch(task[threadIndex].type)
 		{
 		case Task::PRIMITIVES:
@@ -791,21 +1008,39 @@ namespace sw
 				
 				int input = primitiveProgress[unit].firstPrimitive;
 				int count = primitiveProgress[unit].primitiveCount;
-				DrawCall *draw = drawList[primitiveProgress[unit].drawCall % DRAW_COUNT];
+				DrawCall *draw = drawList[primitiveProgress[unit].drawCall % drawCount];
 				int (*setupPrimitives)(Renderer *renderer, int batch, int count) = draw->setupPrimitives;
 
 				processPrimitiveVertices(unit, input, count, draw->count, threadIndex);
 
+				if(profileRoutines)
+				{
+					int64_t tick = Timer::ticks();
+					addRoutineExecution(RoutineVertex, tick - routineTick);
+					routineTick = tick;
+				}
+
 				#if PERF_HUD
 					int64_t time = Timer::ticks();
 					vertexTime[threadIndex] += time - startTick;
 					startTick = time;
 				#endif
 
+				reserveSpans(unit, *draw->data, draw->setupState.multiSample);
 				int visible = setupPrimitives(this, unit, count);
 
+				if(profileRoutines)
+				{
+					addRoutineExecution(RoutineSetup, Timer::ticks() - routineTick);
+				}
+
+				if(draw->tiled)
+				{
+					binPrimitives(unit, visible, draw->setupState.multiSample);
+				}
+
 				primitiveProgress[unit].visible = visible;
-				primitiveProgress[unit].references = clusterCount;
+				queuePixelTasks(unit, threadIndex);
 
 				#if PERF_HUD
 					setupTime[threadIndex] += Timer::ticks() - startTick;
@@ -815,20 +1050,21 @@ namespace sw
 		case Task::PIXELS:
 			{
 				int unit = task[threadIndex].primitiveUnit;
+				int cluster = task[threadIndex].pixelCluster;
 				int visible = primitiveProgress[unit].visible;
 
 				if(visible > 0)
 				{
-					int cluster = task[threadIndex].pixelCluster;
-					Primitive *primitive = primitiveBatch[unit];
-					DrawCall *draw = drawList[pixelProgress[cluster].drawCall % DRAW_COUNT];
-					DrawData *data = draw->data;
-					PixelProcessor::RoutinePointer pixelRoutine = draw->pixelPointer;
+					processPixels(unit, cluster, visible, *drawList[pixelProgress[cluster].drawCall % drawCount]);
 
-					pixelRoutine(primitive, visible, cluster, data);
+					if(profileRoutines)
+					{
+						addRoutineExecution(RoutinePixel, Timer::ticks() - routineTick);
+					}
 				}
 
 				finishRendering(task[threadIndex]);
+				queueNextPixelTask(cluster, threadIndex);
 
 				#if PERF_HUD
 					pixelTime[threadIndex] += Timer::ticks() - startTick;
@@ -855,7 +1091,7 @@ namespace sw
 		int unit = pixelTask.primitiveUnit;
 		int cluster = pixelTask.pixelCluster;
 
-		DrawCall &draw = *drawList[primitiveProgress[unit].drawCall % DRAW_COUNT];
+		DrawCall &draw = *drawList[primitiveProgress[unit].drawCall % drawCount];
 		DrawData &data = *draw.data;
 		int primitive = primitiveProgress[unit].firstPrimitive;
 		int count = primitiveProgress[unit].primitiveCount;
@@ -876,7 +1112,8 @@ namespace sw
 
 			if(ref == 0)
 			{
-				#if PERF_PROFILE
+				if(draw.profile)
+				{
 					for(int cluster = 0; cluster < clusterCount; cluster++)
 					{
 						for(int i = 0; i < PERF_TIMERS; i++)
@@ -884,7 +1121,7 @@ namespace sw
 							profiler.cycles[i] += data.cycles[i][cluster];
 						}
 					}
-				#endif
+				}
 
 				if(draw.queries)
 				{
@@ -943,20 +1180,149 @@ namespace sw
 				draw.setupRoutine->unbind();
 				draw.pixelRoutine->unbind();
 
+				for(int i = 0; i < TOTAL_IMAGE_UNITS; i++)
+				{
+					for(unsigned int method = 0; method < SAMPLER_METHOD_COUNT; method++)
+					{
+						if(draw.samplerRoutine[i][method])
+						{
+							draw.samplerRoutine[i][method]->unbind();
+						}
+					}
+				}
+
 				sync->unlock();
 
 				draw.references = -1;
 				resumeApp->signal();
 			}
 		}
+	}
+
+	void Renderer::reserveSpans(int unit, const DrawData &data, int multiSample)
+	{
+		// Outlines take at most the scissored rows plus the ones above and below, for each sample of each primitive.
+		// The unit's previous primitives have been rasterized by now, so the buffer can be replaced.
+		int size = batchSize * multiSample * (data.scissorY1 - data.scissorY0 + 2);
 
-		pixelProgress[cluster].executing = false;
+		if(size > spanBufferSize[unit])
+		{
+			deallocate(spanBuffer[unit]);
+			spanBuffer[unit] = (Primitive::Span*)allocate(size * sizeof(Primitive::Span));
+			spanBufferSize[unit] = size;
+		}
+	}
+
+	void Renderer::binPrimitives(int unit, int visible, int multiSample)
+	{
+		int *count = binCount[unit];
+		int *index = bin[unit];
+
+		for(int cluster = 0; cluster < clusterCount; cluster++)
+		{
+			count[cluster] = 0;
+		}
+
+		for(int i = 0; i < visible; i++)
+		{
+			const Primitive &primitive = primitiveBatch[unit][i * multiSample];
+
+			int tileX0 = primitive.xMin >> TILE_SIZE_LOG2;
+			int tileY0 = primitive.yMin >> TILE_SIZE_LOG2;
+			int tileY1 = (primitive.yMax - 1) >> TILE_SIZE_LOG2;
+			int columns = min(((primitive.xMax - 1) >> TILE_SIZE_LOG2) - tileX0 + 1, clusterCount);   // Further columns belong to the same clusters
+
+			for(int tileY = tileY0; tileY <= tileY1; tileY++)
+			{
+				for(int tileX = tileX0; tileX < tileX0 + columns; tileX++)
+				{
+					int cluster = (tileX + tileY) & (clusterCount - 1);
+					int *clusterBin = &index[cluster * batchSize];
+
+					if(count[cluster] == 0 || clusterBin[count[cluster] - 1] != i)
+					{
+						clusterBin[count[cluster]++] = i;
+					}
+				}
+			}
+		}
+	}
+
+	void Renderer::processPixels(int unit, int cluster, int visible, const DrawCall &draw)
+	{
+		Primitive *primitive = primitiveBatch[unit];
+		DrawData *data = draw.data;
+		PixelProcessor::RoutinePointer pixelRoutine = draw.pixelPointer;
+
+		if(!draw.tiled)
+		{
+			pixelRoutine(primitive, visible, cluster, data);
+
+			return;
+		}
+
+		int count = binCount[unit][cluster];
+		const int *index = &bin[unit][cluster * batchSize];
+		int multiSample = draw.setupState.multiSample;
+
+		Surface *tracked[4 + 1];   // Targets with deferred clears or tiles to resolve
+		int trackedCount = 0;
+
+		for(int i = 0; i < 4; i++)
+		{
+			if(draw.renderTarget[i] && draw.renderTarget[i]->tracksTiles())
+			{
+				tracked[trackedCount++] = draw.renderTarget[i];
+			}
+		}
+
+		if(draw.depthStencil && draw.depthStencil->tracksTiles())
+		{
+			tracked[trackedCount++] = draw.depthStencil;
+		}
+
+		// This cluster alone renders to its tiles, so it touches them before the first primitive does
+		for(int i = 0; i < count && trackedCount > 0; i++)
+		{
+			const Primitive &binned = primitive[index[i] * multiSample];
+
+			int tileX0 = binned.xMin >> TILE_SIZE_LOG2;
+			int tileX1 = (binned.xMax - 1) >> TILE_SIZE_LOG2;
+			int tileY0 = binned.yMin >> TILE_SIZE_LOG2;
+			int tileY1 = (binned.yMax - 1) >> TILE_SIZE_LOG2;
+
+			for(int tileY = tileY0; tileY <= tileY1; tileY++)
+			{
+				for(int tileX = tileX0 + ((cluster - tileX0 - tileY) & (clusterCount - 1)); tileX <= tileX1; tileX += clusterCount)
+				{
+					for(int j = 0; j < trackedCount; j++)
+					{
+						tracked[j]->touchTile(tileX, tileY);
+					}
+				}
+			}
+		}
+
+		// Consecutive primitives are rendered by a single call
+		for(int i = 0; i < count;)
+		{
+			int run = 1;
+
+			while(i + run < count && index[i + run] == index[i] + run)
+			{
+				run++;
+			}
+
+			pixelRoutine(primitive + index[i] * multiSample, run, cluster, data);
+
+			i += run;
+		}
 	}
 
 	void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned int triangleCount, unsigned int loop, int thread)
 	{
 		Triangle *triangle = triangleBatch[unit];
-		DrawCall *draw = drawList[primitiveProgress[unit].drawCall % DRAW_COUNT];
+		DrawCall *draw = drawList[primitiveProgress[unit].drawCall % drawCount];
 		DrawData *data = draw->data;
 		VertexTask *task = vertexTask[thread];
 
@@ -1384,13 +1750,14 @@ namespace sw
 		Triangle *triangle = renderer->triangleBatch[unit];
 		Primitive *primitive = renderer->primitiveBatch[unit];
 
-		DrawCall &draw = *renderer->drawList[renderer->primitiveProgress[unit].drawCall % DRAW_COUNT];
+		DrawCall &draw = *renderer->drawList[renderer->primitiveProgress[unit].drawCall % renderer->drawCount];
 		SetupProcessor::State &state = draw.setupState;
 		const SetupProcessor::RoutinePointer &setupRoutine = draw.setupPointer;
 
 		int ms = state.multiSample;
 		int pos = state.positionRegister;
 		const DrawData *data = draw.data;
+		Primitive::Span *spans = renderer->spanBuffer[unit];
 		int visible = 0;
 
 		for(int i = 0; i < count; i++, triangle++)
@@ -1413,8 +1780,11 @@ namespace sw
 					}
 				}
 
+				primitive->outline = spans;
+
 				if(setupRoutine(primitive, triangle, &polygon, data))
 				{
+					spans = primitive[ms - 1].outline + primitive->yMax + 1;
 					primitive += ms;
 					visible++;
 				}
@@ -1430,7 +1800,7 @@ namespace sw
 		Primitive *primitive = renderer->primitiveBatch[unit];
 		int visible = 0;
 
-		DrawCall &draw = *renderer->drawList[renderer->primitiveProgress[unit].drawCall % DRAW_COUNT];
+		DrawCall &draw = *renderer->drawList[renderer->primitiveProgress[unit].drawCall % renderer->drawCount];
 		SetupProcessor::State &state = draw.setupState;
 		SetupProcessor::RoutinePointer setupRoutine = draw.setupPointer;
 
@@ -1466,11 +1836,17 @@ namespace sw
 			}
 		}
 
+		int ms = state.multiSample;
+		Primitive::Span *spans = renderer->spanBuffer[unit];
+
 		for(int i = 0; i < 3; i++)
 		{
+			primitive->outline = spans;
+
 			if(setupLine(renderer, *primitive, *triangle, draw))
 			{
 				primitive->area = 0.5f * d;
+				spans = primitive[ms - 1].outline + primitive->yMax + 1;
 
 				primitive++;
 				visible++;
@@ -1488,7 +1864,7 @@ namespace sw
 		Primitive *primitive = renderer->primitiveBatch[unit];
 		int visible = 0;
 
-		DrawCall &draw = *renderer->drawList[renderer->primitiveProgress[unit].drawCall % DRAW_COUNT];
+		DrawCall &draw = *renderer->drawList[renderer->primitiveProgress[unit].drawCall % renderer->drawCount];
 		SetupProcessor::State &state = draw.setupState;
 
 		const Vertex &v0 = triangle[0].v0;
@@ -1510,11 +1886,17 @@ namespace sw
 		triangle[1].v0 = v1;
 		triangle[2].v0 = v2;
 
+		int ms = state.multiSample;
+		Primitive::Span *spans = renderer->spanBuffer[unit];
+
 		for(int i = 0; i < 3; i++)
 		{
+			primitive->outline = spans;
+
 			if(setupPoint(renderer, *primitive, *triangle, draw))
 			{
 				primitive->area = 0.5f * d;
+				spans = primitive[ms - 1].outline + primitive->yMax + 1;
 
 				primitive++;
 				visible++;
@@ -1532,15 +1914,19 @@ namespace sw
 		Primitive *primitive = renderer->primitiveBatch[unit];
 		int visible = 0;
 
-		DrawCall &draw = *renderer->drawList[renderer->primitiveProgress[unit].drawCall % DRAW_COUNT];
+		DrawCall &draw = *renderer->drawList[renderer->primitiveProgress[unit].drawCall % renderer->drawCount];
 		SetupProcessor::State &state = draw.setupState;
 
 		int ms = state.multiSample;
+		Primitive::Span *spans = renderer->spanBuffer[unit];
 
 		for(int i = 0; i < count; i++)
 		{
+			primitive->outline = spans;
+
 			if(setupLine(renderer, *primitive, *triangle, draw))
 			{
+				spans = primitive[ms - 1].outline + primitive->yMax + 1;
 				primitive += ms;
 				visible++;
 			}
@@ -1557,15 +1943,19 @@ namespace sw
 		Primitive *primitive = renderer->primitiveBatch[unit];
 		int visible = 0;
 
-		DrawCall &draw = *renderer->drawList[renderer->primitiveProgress[unit].drawCall % DRAW_COUNT];
+		DrawCall &draw = *renderer->drawList[renderer->primitiveProgress[unit].drawCall % renderer->drawCount];
 		SetupProcessor::State &state = draw.setupState;
 
 		int ms = state.multiSample;
+		Primitive::Span *spans = renderer->spanBuffer[unit];
 
 		for(int i = 0; i < count; i++)
 		{
+			primitive->outline = spans;
+
 			if(setupPoint(renderer, *primitive, *triangle, draw))
 			{
+				spans = primitive[ms - 1].outline + primitive->yMax + 1;
 				primitive += ms;
 				visible++;
 			}
@@ -1870,14 +2260,74 @@ namespace sw
 		unitCount = ceilPow2(threadCount);
 		clusterCount = ceilPow2(threadCount);
 
+		triangleBatch = new Triangle*[unitCount];
+		primitiveBatch = new Primitive*[unitCount];
+		binCount = new int*[unitCount];
+		bin = new int*[unitCount];
+		spanBuffer = new Primitive::Span*[unitCount];
+		spanBufferSize = new int[unitCount];
+		primitiveProgress = new PrimitiveProgress[unitCount];
+
 		for(int i = 0; i < unitCount; i++)
 		{
 			triangleBatch[i] = (Triangle*)allocate(batchSize * sizeof(Triangle));
 			primitiveBatch[i] = (Primitive*)allocate(batchSize * sizeof(Primitive));
+			binCount[i] = (int*)allocate(clusterCount * sizeof(int));
+			bin[i] = (int*)allocate(clusterCount * batchSize * sizeof(int));
+			spanBuffer[i] = 0;   // Sized for the scissor rectangle of the first draw call
+			spanBufferSize[i] = 0;
+			primitiveProgress[i].init();
+		}
+
+		pixelProgress = new PixelProgress[clusterCount];
+
+		for(int cluster = 0; cluster < clusterCount; cluster++)
+		{
+			pixelProgress[cluster].init();
+		}
+
+		// All threads are idle, so the draw calls are free and can be sized for the new cluster count.
+		// Each primitive unit can be processing a different draw call while as many are being set up.
+		for(int draw = 0; draw < drawCount; draw++)
+		{
+			delete drawCall[draw];
+		}
+
+		delete[] drawCall;
+		delete[] drawList;
+
+		drawCount = drawCallCount ? drawCallCount : max(2 * unitCount, 16);
+		drawCall = new DrawCall*[drawCount];
+		drawList = new DrawCall*[drawCount];
+
+		for(int draw = 0; draw < drawCount; draw++)
+		{
+			drawCall[draw] = new DrawCall(clusterCount);
+			drawList[draw] = drawCall[draw];
 		}
 
+		currentDraw = 0;   // Matches the pixel progress of all clusters
+		nextDraw = 0;
+
+		vertexTask = new VertexTask*[threadCount];
+		worker = new Thread*[threadCount];
+		resume = new Event*[threadCount];
+		suspend = new Event*[threadCount];
+		task = new Task[threadCount];
+		taskQueue = new TaskQueue[threadCount];
+
+		#if PERF_HUD
+			vertexTime = new int64_t[threadCount];
+			setupTime = new int64_t[threadCount];
+			pixelTime = new int64_t[threadCount];
+
+			resetTimers();
+		#endif
+
 		for(int i = 0; i < threadCount; i++)
 		{
+			taskQueue[i].init(unitCount + clusterCount);
+
 			vertexTask[i] = (VertexTask*)allocate(sizeof(VertexTask));
 			vertexTask[i]->vertexCache.drawCall = -1;
 
@@ -1896,6 +2346,8 @@ namespace sw
 			suspend[i]->wait();
 			suspend[i]->signal();
 		}
+
+		Surface::startResolveThreads(threadCount);
 	}
 
 	void Renderer::terminateThreads()
@@ -1905,34 +2357,72 @@ namespace sw
 			Thread::sleep(1);
 		}
 
+		if(!worker)
+		{
+			return;   // Not started yet
+		}
+
 		for(int thread = 0; thread < threadCount; thread++)
 		{
-			if(worker[thread])
-			{
-				exitThreads = true;
-				resume[thread]->signal();
-				worker[thread]->join();
-				
-				delete worker[thread];
-				worker[thread] = 0;
-				delete resume[thread];
-				resume[thread] = 0;
-				delete suspend[thread];
-				suspend[thread] = 0;
-			}
-		
+			exitThreads = true;
+			resume[thread]->signal();
+			worker[thread]->join();
+
+			delete worker[thread];
+			delete resume[thread];
+			delete suspend[thread];
+
 			deallocate(vertexTask[thread]);
-			vertexTask[thread] = 0;
 		}
 
-		for(int i = 0; i < 16; i++)
+		Surface::stopResolveThreads();
+
+		for(int i = 0; i < unitCount; i++)
 		{
 			deallocate(triangleBatch[i]);
-			triangleBatch[i] = 0;
-
 			deallocate(primitiveBatch[i]);
-			primitiveBatch[i] = 0;
-		}
+			deallocate(binCount[i]);
+			deallocate(bin[i]);
+			deallocate(spanBuffer[i]);
+		}
+
+		delete[] worker;
+		worker = 0;
+		delete[] resume;
+		resume = 0;
+		delete[] suspend;
+		suspend = 0;
+		delete[] vertexTask;
+		vertexTask = 0;
+		delete[] task;
+		task = 0;
+		delete[] taskQueue;
+		taskQueue = 0;
+		delete[] triangleBatch;
+		triangleBatch = 0;
+		delete[] primitiveBatch;
+		primitiveBatch = 0;
+		delete[] binCount;
+		binCount = 0;
+		delete[] bin;
+		bin = 0;
+		delete[] spanBuffer;
+		spanBuffer = 0;
+		delete[] spanBufferSize;
+		spanBufferSize = 0;
+		delete[] primitiveProgress;
+		primitiveProgress = 0;
+		delete[] pixelProgress;
+		pixelProgress = 0;
+
+		#if PERF_HUD
+			delete[] vertexTime;
+			vertexTime = 0;
+			delete[] setupTime;
+			setupTime = 0;
+			delete[] pixelTime;
+			pixelTime = 0;
+		#endif
 	}
 
 	void Renderer::loadConstants(const VertexShader *vertexShader)
@@ -2260,7 +2750,7 @@ namespace sw
 
 	void Renderer::setPixelShaderConstantF(int index, const float value[4], int count)
 	{
-		for(int i = 0; i < DRAW_COUNT; i++)
+		for(int i = 0; i < drawCount; i++)
 		{
 			if(drawCall[i]->psDirtyConstF < index + count)
 			{
@@ -2277,7 +2767,7 @@ namespace sw
 
 	void Renderer::setPixelShaderConstantI(int index, const int value[4], int count)
 	{
-		for(int i = 0; i < DRAW_COUNT; i++)
+		for(int i = 0; i < drawCount; i++)
 		{
 			if(drawCall[i]->psDirtyConstI < index + count)
 			{
@@ -2294,7 +2784,7 @@ namespace sw
 
 	void Renderer::setPixelShaderConstantB(int index, const int *boolean, int count)
 	{
-		for(int i = 0; i < DRAW_COUNT; i++)
+		for(int i = 0; i < drawCount; i++)
 		{
 			if(drawCall[i]->psDirtyConstB < index + count)
 			{
@@ -2311,7 +2801,7 @@ namespace sw
 
 	void Renderer::setVertexShaderConstantF(int index, const float value[4], int count)
 	{
-		for(int i = 0; i < DRAW_COUNT; i++)
+		for(int i = 0; i < drawCount; i++)
 		{
 			if(drawCall[i]->vsDirtyConstF < index + count)
 			{
@@ -2328,7 +2818,7 @@ namespace sw
 
 	void Renderer::setVertexShaderConstantI(int index, const int value[4], int count)
 	{
-		for(int i = 0; i < DRAW_COUNT; i++)
+		for(int i = 0; i < drawCount; i++)
 		{
 			if(drawCall[i]->vsDirtyConstI < index + count)
 			{
@@ -2345,7 +2835,7 @@ namespace sw
 
 	void Renderer::setVertexShaderConstantB(int index, const int *boolean, int count)
 	{
-		for(int i = 0; i < DRAW_COUNT; i++)
+		for(int i = 0; i < drawCount; i++)
 		{
 			if(drawCall[i]->vsDirtyConstB < index + count)
 			{
@@ -2396,7 +2886,7 @@ namespace sw
 	#if PERF_HUD
 		int Renderer::getThreadCount()
 		{
-			return threadCount;
+			return worker ? threadCount : 0;
 		}
 		
 		int64_t Renderer::getVertexTime(int thread)
@@ -2416,7 +2906,7 @@ namespace sw
 
 		void Renderer::resetTimers()
 		{
-			for(int thread = 0; thread < threadCount; thread++)
+			for(int thread = 0; thread < getThreadCount(); thread++)
 			{
 				vertexTime[thread] = 0;
 				setupTime[thread] = 0;
@@ -2465,10 +2955,9 @@ namespace sw
 			precacheVertex = !newConfiguration && configuration.precache;
 			precacheSetup = !newConfiguration && configuration.precache;
 			precachePixel = !newConfiguration && configuration.precache;
-
-			VertexProcessor::setRoutineCacheSize(configuration.vertexRoutineCacheSize);
-			PixelProcessor::setRoutineCacheSize(configuration.pixelRoutineCacheSize);
-			SetupProcessor::setRoutineCacheSize(configuration.setupRoutineCacheSize);
+			precacheSampler = !newConfiguration && configuration.precache;
+			backgroundCompilation = configuration.backgroundCompilation;
+			recompileThreshold = max(configuration.recompileThreshold, 1);
 
 			switch(configuration.textureSampleQuality)
 			{
@@ -2541,30 +3030,48 @@ namespace sw
 			default: threadCount = configuration.threadCount; break;
 			}
 
+			drawCallCount = clamp(configuration.drawCallCount, 0, 256);
+
 			CPUID::setEnableSSE4_1(configuration.enableSSE4_1);
 			CPUID::setEnableSSSE3(configuration.enableSSSE3);
 			CPUID::setEnableSSE3(configuration.enableSSE3);
 			CPUID::setEnableSSE2(configuration.enableSSE2);
 			CPUID::setEnableSSE(configuration.enableSSE);
 
-			for(int pass = 0; pass < 10; pass++)
+			for(int type = 0; type < RoutineTypeCount; type++)
 			{
-				optimization[pass] = configuration.optimization[pass];
+				for(int pass = 0; pass < 10; pass++)
+				{
+					optimization[type][pass] = configuration.optimization[type][pass];
+				}
 			}
 
+			optimizationProfiling = configuration.optimizationProfiling;
+			pipelineProfiling = configuration.pipelineProfiling;
+			tiledRasterization = configuration.tiledRasterization;
+			halfSpaceRasterization = configuration.halfSpaceRasterization;
+
 			forceWindowed = configuration.forceWindowed;
 			complementaryDepthBuffer = configuration.complementaryDepthBuffer;
 			postBlendSRGB = configuration.postBlendSRGB;
 			exactColorRounding = configuration.exactColorRounding;
 			forceClearRegisters = configuration.forceClearRegisters;
 
+			sharedRoutineCache = configuration.sharedRoutineCache;
+			routineCacheBudget = clamp(configuration.routineCacheMemory, 0, 1024) << 20;
+
+			// Precached routines are validated against the enabled CPU features
+			VertexProcessor::setRoutineCacheSize(configuration.vertexRoutineCacheSize);
+			PixelProcessor::setRoutineCacheSize(configuration.pixelRoutineCacheSize);
+			SetupProcessor::setRoutineCacheSize(configuration.setupRoutineCacheSize);
+
 		#ifndef NDEBUG
 			minPrimitives = configuration.minPrimitives;
 			maxPrimitives = configuration.maxPrimitives;
 		#endif
 		}
 
-		if(!initialUpdate && !worker[0])
+		if(!initialUpdate && !worker)
 		{
 			initializeThreads();
 		}
@@ -17,6 +17,7 @@
 #include "SetupProcessor.hpp"
 #include "Plane.hpp"
 #include "Blitter.hpp"
+#include "Primitive.hpp"
 #include "Common/MutexLock.hpp"
 #include "Common/Thread.hpp"
 #include "Main/Config.hpp"
@@ -35,9 +36,6 @@ namespace sw
 	struct Constants;
 
 	extern int batchSize;
-	extern int threadCount;
-	extern int unitCount;
-	extern int clusterCount;
 
 	enum TranscendentalPrecision
 	{
@@ -113,6 +111,7 @@ namespace sw
 		const void *input[VERTEX_ATTRIBUTES];
 		unsigned int stride[VERTEX_ATTRIBUTES];
 		Texture mipmap[TOTAL_IMAGE_UNITS];
+		const void *samplerRoutine[TOTAL_IMAGE_UNITS][SAMPLER_METHOD_COUNT];   // Entries for the methods the shaders use
 		const void *indices;
 
 		struct VS
@@ -147,11 +146,8 @@ namespace sw
 		PixelProcessor::Stencil stencilCCW;
 		PixelProcessor::Fog fog;
 		PixelProcessor::Factor factor;
-		unsigned int occlusion[16];   // Number of pixels passing depth test
-
-		#if PERF_PROFILE
-			int64_t cycles[PERF_TIMERS][16];
-		#endif
+		unsigned int *occlusion;   // Per cluster, number of pixels passing depth test
+		int64_t *cycles[PERF_TIMERS];   // Per cluster, when the pixel routine is profiling
 
 		TextureStage::Uniforms textureStage[8];
 
@@ -175,6 +171,8 @@ namespace sw
 		float *depthBuffer;
 		int depthPitchB;
 		int depthSliceB;
+		float *hiZ;   // Upper bound of the depth per block
+		int hiZPitchB;
 		unsigned char *stencilBuffer;
 		int stencilPitchB;
 		int stencilSliceB;
@@ -192,7 +190,7 @@ namespace sw
 
 	struct DrawCall
 	{
-		DrawCall();
+		DrawCall(int clusterCount);
 
 		~DrawCall();
 
@@ -209,12 +207,15 @@ namespace sw
 
 		int (*setupPrimitives)(Renderer *renderer, int batch, int count);
 		SetupProcessor::State setupState;
+		bool profile;
+		bool tiled;   // Visible primitives get binned to the clusters whose tiles they overlap
 
 		Resource *vertexStream[VERTEX_ATTRIBUTES];
 		Resource *indexBuffer;
 		Surface *renderTarget[4];
 		Surface *depthStencil;
 		Resource *texture[TOTAL_IMAGE_UNITS];
+		Routine *samplerRoutine[TOTAL_IMAGE_UNITS][SAMPLER_METHOD_COUNT];
 
 		int vsDirtyConstF;
 		int vsDirtyConstI;
@@ -263,6 +264,44 @@ namespace sw
 			volatile int pixelCluster;
 		};
 
+		// Tasks queued by one thread, which idle threads steal from the other end
+		struct TaskQueue
+		{
+			TaskQueue()
+			{
+				task = 0;
+				size = 0;
+				top = 0;
+				bottom = 0;
+			}
+
+			~TaskQueue()
+			{
+				delete[] task;
+			}
+
+			void init(int size)
+			{
+				this->size = ceilPow2(size);   // The counters wrap around to an index modulo the size
+
+				delete[] task;
+				task = new Task[this->size];
+
+				top = 0;
+				bottom = 0;
+			}
+
+			void push(const Task &task);
+			bool pop(Task &task);     // Newest first, by the owning thread
+			bool steal(Task &task);   // Oldest first, by other threads
+
+			Task *task;
+			unsigned int size;   // Power of two, at most one task per primitive unit and per pixel cluster is queued
+			volatile unsigned int top;
+			volatile unsigned int bottom;
+			BackoffLock mutex;
+		};
+
 		struct PrimitiveProgress
 		{
 			void init()
@@ -272,6 +311,7 @@ namespace sw
 				primitiveCount = 0;
 				visible = 0;
 				references = 0;
+				sequence = 0;
 			}
 
 			volatile int drawCall;
@@ -279,6 +319,7 @@ namespace sw
 			volatile int primitiveCount;
 			volatile int visible;
 			volatile int references;
+			volatile int sequence;   // Odd while a batch is being assigned, for reading without the scheduler lock
 		};
 
 		struct PixelProgress
@@ -287,12 +328,12 @@ namespace sw
 			{
 				drawCall = 0;
 				processedPrimitives = 0;
-				executing = false;
+				executing = 0;
 			}
 
 			volatile int drawCall;
 			volatile int processedPrimitives;
-			volatile bool executing;
+			volatile int executing;   // Claimed by a queued or running task, which alone updates the progress
 		};
 
 	public:
@@ -372,12 +413,21 @@ namespace sw
 		static void threadFunction(void *parameters);
 		void threadLoop(int threadIndex);
 		void taskLoop(int threadIndex);
-		void findAvailableTasks();
+		int findAvailableTasks(int threadIndex);
 		void scheduleTask(int threadIndex);
 		void executeTask(int threadIndex);
 		void finishRendering(Task &pixelTask);
+		void queuePixelTasks(int unit, int threadIndex);
+		void queueNextPixelTask(int cluster, int threadIndex);
+		bool claimCluster(int cluster, int drawCall, int firstPrimitive);
+		int findPrimitiveUnit(int drawCall, int firstPrimitive);
+		void queueTask(Task::Type type, int unit, int cluster, int threadIndex);
+		void resumeThreads(int count);
 
 		void processPrimitiveVertices(int unit, unsigned int start, unsigned int count, unsigned int loop, int thread);
+		void reserveSpans(int unit, const DrawData &data, int multiSample);
+		void binPrimitives(int unit, int visible, int multiSample);
+		void processPixels(int unit, int cluster, int visible, const DrawCall &draw);
 
 		static int setupSolidTriangles(Renderer *renderer, int batch, int count);
 		static int setupWireframeTriangle(Renderer *renderer, int batch, int count);
@@ -404,8 +454,12 @@ namespace sw
 		Rect scissor;
 		int clipFlags;
 
-		Triangle *triangleBatch[16];
-		Primitive *primitiveBatch[16];
+		Triangle **triangleBatch;     // Per primitive unit
+		Primitive **primitiveBatch;   // Per primitive unit
+		int **binCount;               // Per primitive unit, number of binned primitives for each cluster
+		int **bin;                    // Per primitive unit, indices of the visible primitives overlapping each cluster's tiles
+		Primitive::Span **spanBuffer;   // Per primitive unit, outlines of the visible primitives
+		int *spanBufferSize;            // Per primitive unit, in spans
 
 		// User-defined clipping planes
 		Plane userPlane[MAX_CLIP_PLANES];
@@ -414,35 +468,37 @@ namespace sw
 
 		volatile bool exitThreads;
 		volatile int threadsAwake;
-		Thread *worker[16];
-		Event *resume[16];         // Events for resuming threads
-		Event *suspend[16];        // Events for suspending threads
-		Event *resumeApp;          // Event for resuming the application thread
+		Thread **worker;     // Allocated along with the other per-thread state when the threads are started
+		Event **resume;      // Events for resuming threads
+		Event **suspend;     // Events for suspending threads
+		Event *resumeApp;    // Event for resuming the application thread
 
-		PrimitiveProgress primitiveProgress[16];
-		PixelProgress pixelProgress[16];
-		Task task[16];   // Current tasks for threads
+		PrimitiveProgress *primitiveProgress;
+		PixelProgress *pixelProgress;
+		Task *task;   // Current tasks for threads
 
-		enum {DRAW_COUNT = 16};   // Number of draw calls buffered
-		DrawCall *drawCall[DRAW_COUNT];
-		DrawCall *drawList[DRAW_COUNT];
+		int threadCount;    // Started by this renderer, from the configuration
+		int unitCount;      // Primitive units
+		int clusterCount;   // Pixel clusters, which the pixel routines get compiled for
+
+		int drawCallCount;   // Configured number of draw calls to buffer, or 0 to size it for the primitive units
+		int drawCount;       // Number of draw calls buffered
+		DrawCall **drawCall;
+		DrawCall **drawList;
 
 		volatile int currentDraw;
 		volatile int nextDraw;
 
-		Task taskQueue[32];
-		unsigned int qHead;
-		unsigned int qSize;
-
-		BackoffLock schedulerMutex;
+		TaskQueue *taskQueue;         // Per thread
+		MutexLock schedulerMutex;     // Assigning primitive batches, and suspending and resuming threads
 
 		#if PERF_HUD
-			int64_t vertexTime[16];
-			int64_t setupTime[16];
-			int64_t pixelTime[16];
+			int64_t *vertexTime;
+			int64_t *setupTime;
+			int64_t *pixelTime;
 		#endif
 
-		VertexTask *vertexTask[16];
+		VertexTask **vertexTask;
 
 		SwiftConfig *swiftConfig;
 
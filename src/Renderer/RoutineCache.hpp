@@ -15,34 +15,97 @@
 #include "LRUCache.hpp"
 
 #include "Reactor/Reactor.hpp"
+#include "Common/MutexLock.hpp"
+
+#if !defined(_WIN32)
+	#include "Reactor/PrecacheFile.hpp"
+	#include <stdlib.h>
+	#include <string.h>
+#endif
 
 namespace sw
 {
+	extern bool sharedRoutineCache;
+	extern int routineCacheBudget;             // Bytes of code held by all routine caches, zero for unlimited
+	extern volatile int routineCacheMemory;
+
+	// Modifications are serialized while lookups run concurrently, so a cache can be shared by renderers
+	// on different threads.
+	// Routines merged ahead of time get loaded from $SWIFTSHADER_PRECACHE_DIR/<prebuilt>.cache.
 	template<class State>
 	class RoutineCache : public LRUCache<State, Routine>
 	{
 	public:
-		RoutineCache(int n, const char *precache = 0);
+		RoutineCache(int n, const char *precache = 0, const char *prebuilt = 0);
 		~RoutineCache();
 
+		static RoutineCache *share(int n, const char *precache = 0, const char *prebuilt = 0);   // Process-wide cache, sized by its first user
+		static void release(RoutineCache *cache);                      // Deletes the cache once no longer shared
+
+		Routine *add(const State &state, Routine *routine);
+		Routine *replace(const State &state, Routine *routine);
+
+		// Return the cached routine bound, for the caller to unbind
+		Routine *acquire(const State &state);
+		Routine *acquire(const State &state, Routine *routine);   // Adds the routine, unless another thread added the state first
+
+		// Lookups by all caches for this type of state, wrapping around
+		static unsigned int getHits();
+		static unsigned int getMisses();
+
 	private:
+		void insert(const State &state, Routine *routine);
+		void discard(Routine *routine);
+		void precacheRoutine(const State &state, Routine *routine);
+		#if !defined(_WIN32)
+		void loadPrecache(PrecacheFile &file);
+		#endif
+
+		ReadWriteLock mutex;   // Shared by lookups, exclusive for modifications
+		int memory;       // Bytes of code
+		int references;
+
+		static RoutineCache *shared;
+		static BackoffLock sharedMutex;
+
+		static volatile int hits;
+		static volatile int misses;
+
 		const char *precache;
 		#if defined(_WIN32)
 		HMODULE precacheDLL;
+		#else
+		PrecacheFile *precacheFile;
 		#endif
 	};
 }
 
+#include "Shader/Constants.hpp"
+
 #if defined(_WIN32)
-	#include "Shader/Constants.hpp"
 	#include "Reactor/DLL.hpp"
 #endif
 
 namespace sw
 {
 	template<class State>
-	RoutineCache<State>::RoutineCache(int n, const char *precache) : LRUCache<State, Routine>(n), precache(precache)
+	RoutineCache<State> *RoutineCache<State>::shared = 0;
+
+	template<class State>
+	BackoffLock RoutineCache<State>::sharedMutex;
+
+	template<class State>
+	volatile int RoutineCache<State>::hits = 0;
+
+	template<class State>
+	volatile int RoutineCache<State>::misses = 0;
+
+	template<class State>
+	RoutineCache<State>::RoutineCache(int n, const char *precache, const char *prebuilt) : LRUCache<State, Routine>(n), precache(precache)
 	{
+		memory = 0;
+		references = 1;
+
 		#if defined(_WIN32)
 			precacheDLL = 0;
 
@@ -84,6 +147,26 @@ namespace sw
 					fclose(dir);
 				}
 			}
+		#else
+			precacheFile = 0;
+
+			if(precache)
+			{
+				char fileName[1024]; sprintf(fileName, "%s.cache", precache);
+
+				precacheFile = new PrecacheFile(fileName, sizeof(State), &constants, sizeof(Constants));
+				loadPrecache(*precacheFile);
+			}
+
+			const char *directory = getenv("SWIFTSHADER_PRECACHE_DIR");
+
+			if(prebuilt && directory)   // After the recorded routines, which are more recent
+			{
+				char fileName[1024]; snprintf(fileName, sizeof(fileName), "%s/%s.cache", directory, prebuilt);
+
+				PrecacheFile prebuiltFile(fileName, sizeof(State), &constants, sizeof(Constants), true);
+				loadPrecache(prebuiltFile);
+			}
 		#endif
 	}
 
@@ -104,7 +187,7 @@ namespace sw
 					State &state = getKey(i);
 					Routine *routine = query(state);
 
-					if(routine)
+					if(routine && routine->isOptimized() && routine->isPrecachable())
 					{
 						unsigned char *buffer = (unsigned char*)routine->getBuffer();
 						unsigned char *entry = (unsigned char*)routine->getEntry();
@@ -165,8 +248,225 @@ namespace sw
 				remove(dllName);
 				remove(dirName);
 			}
+		#else
+			delete precacheFile;
+		#endif
+
+		atomicAdd(&routineCacheMemory, -memory);   // Remaining routines get unbound by the LRUCache
+	}
+
+	template<class State>
+	RoutineCache<State> *RoutineCache<State>::share(int n, const char *precache, const char *prebuilt)
+	{
+		sharedMutex.lock();
+
+		if(shared)
+		{
+			shared->references++;
+		}
+		else
+		{
+			shared = new RoutineCache(n, precache, prebuilt);
+		}
+
+		RoutineCache *cache = shared;
+
+		sharedMutex.unlock();
+
+		return cache;
+	}
+
+	template<class State>
+	void RoutineCache<State>::release(RoutineCache *cache)
+	{
+		if(!cache)
+		{
+			return;
+		}
+
+		sharedMutex.lock();
+
+		bool unused = --cache->references == 0;
+
+		if(unused && cache == shared)
+		{
+			shared = 0;
+		}
+
+		sharedMutex.unlock();
+
+		if(unused)
+		{
+			delete cache;
+		}
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::add(const State &state, Routine *routine)
+	{
+		routine->bind();   // Until precached, should another thread evict it
+		mutex.lock();
+
+		insert(state, routine);
+
+		mutex.unlock();
+
+		precacheRoutine(state, routine);
+		routine->unbind();
+
+		return routine;
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::replace(const State &state, Routine *routine)
+	{
+		routine->bind();   // Until precached, should another thread evict it
+		mutex.lock();
+
+		if(this->query(state))
+		{
+			int size = routine->getBufferSize();
+			memory += size;
+			atomicAdd(&routineCacheMemory, size);
+
+			discard(LRUCache<State, Routine>::replace(state, routine));
+		}
+		else
+		{
+			insert(state, routine);
+		}
+
+		mutex.unlock();
+
+		precacheRoutine(state, routine);
+		routine->unbind();
+
+		return routine;
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::acquire(const State &state)
+	{
+		mutex.lockShared();
+
+		Routine *routine = this->query(state);
+
+		if(routine)
+		{
+			routine->bind();   // Before a writer can evict it
+		}
+
+		mutex.unlockShared();
+
+		atomicIncrement(routine ? &hits : &misses);
+
+		return routine;
+	}
+
+	template<class State>
+	unsigned int RoutineCache<State>::getHits()
+	{
+		return hits;
+	}
+
+	template<class State>
+	unsigned int RoutineCache<State>::getMisses()
+	{
+		return misses;
+	}
+
+	template<class State>
+	Routine *RoutineCache<State>::acquire(const State &state, Routine *routine)
+	{
+		mutex.lock();
+
+		Routine *cached = this->query(state);
+
+		if(cached)
+		{
+			delete routine;   // Compiled concurrently by another thread
+			routine = cached;
+		}
+		else
+		{
+			insert(state, routine);
+		}
+
+		routine->bind();
+
+		mutex.unlock();
+
+		if(!cached)
+		{
+			precacheRoutine(state, routine);   // Scans and writes the code, so outside of the lock
+		}
+
+		return routine;
+	}
+
+	template<class State>
+	void RoutineCache<State>::insert(const State &state, Routine *routine)
+	{
+		int size = routine->getBufferSize();
+
+		// Shrink this cache until all caches together fit the budget
+		while(routineCacheBudget > 0 && routineCacheMemory + size > routineCacheBudget && this->getCount() > 0)
+		{
+			discard(LRUCache<State, Routine>::evict());
+		}
+
+		memory += size;
+		atomicAdd(&routineCacheMemory, size);
+
+		discard(LRUCache<State, Routine>::add(state, routine));
+	}
+
+	template<class State>
+	void RoutineCache<State>::discard(Routine *routine)
+	{
+		if(routine)
+		{
+			int size = routine->getBufferSize();
+			memory -= size;
+			atomicAdd(&routineCacheMemory, -size);
+
+			routine->unbind();
+		}
+	}
+
+	template<class State>
+	void RoutineCache<State>::precacheRoutine(const State &state, Routine *routine)
+	{
+		#if !defined(_WIN32)
+			if(precacheFile && routine->isOptimized() && routine->isPrecachable())   // Unoptimized routines get replaced when hot
+			{
+				precacheFile->addRoutine(&state, routine);
+			}
 		#endif
 	}
+
+	#if !defined(_WIN32)
+	template<class State>
+	void RoutineCache<State>::loadPrecache(PrecacheFile &file)
+	{
+		// Newest first, so recompiled routines take precedence over older duplicates
+		for(int i = file.getRoutineCount() - 1; i >= 0; i--)
+		{
+			State state;
+			memcpy(&state, file.getKey(i), sizeof(State));
+
+			if(!this->query(state))
+			{
+				Routine *routine = file.loadRoutine(i);
+
+				if(routine)
+				{
+					insert(state, routine);
+				}
+			}
+		}
+	}
+	#endif
 }
 
 #endif   // sw_RoutineCache_hpp
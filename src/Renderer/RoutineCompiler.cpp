@@ -0,0 +1,161 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+#include "RoutineCompiler.hpp"
+
+#include "Reactor/Routine.hpp"
+#include "Reactor/Nucleus.hpp"
+
+namespace sw
+{
+	bool backgroundCompilation = false;
+	int recompileThreshold = 16;
+
+	RoutineCompiler::Task::Task()
+	{
+		routine = 0;
+		generation = 0;
+	}
+
+	RoutineCompiler::Task::~Task()
+	{
+		if(routine)
+		{
+			routine->unbind();
+		}
+	}
+
+	Routine *RoutineCompiler::Task::getRoutine()
+	{
+		return routine;
+	}
+
+	RoutineCompiler::RoutineCompiler()
+	{
+		generation = 0;
+		exit = false;
+
+		event = new Event();
+		thread = new Thread(threadFunction, this);
+	}
+
+	RoutineCompiler::~RoutineCompiler()
+	{
+		mutex.lock();
+		exit = true;
+		mutex.unlock();
+
+		event->signal();
+		thread->join();
+
+		delete thread;
+		delete event;
+
+		discard();
+	}
+
+	void RoutineCompiler::queue(Task *task)
+	{
+		mutex.lock();
+		task->generation = generation;
+		pending.push_back(task);
+		mutex.unlock();
+
+		event->signal();
+	}
+
+	RoutineCompiler::Task *RoutineCompiler::retrieve()
+	{
+		Task *task = 0;
+
+		mutex.lock();
+
+		if(!completed.empty())
+		{
+			task = completed.front();
+			completed.pop_front();
+		}
+
+		mutex.unlock();
+
+		return task;
+	}
+
+	void RoutineCompiler::discard()
+	{
+		mutex.lock();
+
+		generation++;   // The task in progress gets dropped when done
+
+		pending.splice(pending.end(), completed);
+		std::list<Task*> discarded;
+		discarded.swap(pending);
+
+		mutex.unlock();
+
+		for(std::list<Task*>::iterator task = discarded.begin(); task != discarded.end(); task++)
+		{
+			delete *task;
+		}
+	}
+
+	void RoutineCompiler::threadFunction(void *parameters)
+	{
+		RoutineCompiler *compiler = static_cast<RoutineCompiler*>(parameters);
+
+		compiler->compileLoop();
+
+		Nucleus::releaseThread();
+	}
+
+	void RoutineCompiler::compileLoop()
+	{
+		while(!exit)
+		{
+			event->wait();
+
+			while(true)
+			{
+				mutex.lock();
+
+				if(exit || pending.empty())
+				{
+					mutex.unlock();
+					break;
+				}
+
+				Task *task = pending.front();
+				pending.pop_front();
+
+				mutex.unlock();
+
+				task->routine = task->compile();
+				task->routine->bind();
+
+				mutex.lock();
+
+				bool current = task->generation == generation;
+
+				if(current)
+				{
+					completed.push_back(task);
+				}
+
+				mutex.unlock();
+
+				if(!current)
+				{
+					delete task;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,70 @@
+// SwiftShader Software Renderer
+//
+// Copyright(c) 2005-2012 TransGaming Inc.
+//
+// All rights reserved. No part of this software may be copied, distributed, transmitted,
+// transcribed, stored in a retrieval system, translated into any human or computer
+// language by any means, or disclosed to third parties without the explicit written
+// agreement of TransGaming Inc. Without such an agreement, no rights or licenses, express
+// or implied, including but not limited to any patent rights, are granted to you.
+//
+
+#ifndef sw_RoutineCompiler_hpp
+#define sw_RoutineCompiler_hpp
+
+#include "Common/MutexLock.hpp"
+#include "Common/Thread.hpp"
+
+#include <list>
+
+namespace sw
+{
+	class Routine;
+
+	// Compiles optimized routines on a background thread, replacing unoptimized ones once they're hot
+	class RoutineCompiler
+	{
+	public:
+		class Task
+		{
+			friend class RoutineCompiler;
+
+		public:
+			Task();
+
+			virtual ~Task();
+
+			Routine *getRoutine();
+
+		protected:
+			virtual Routine *compile() = 0;   // Called on the compiler thread
+
+		private:
+			Routine *routine;   // Bound until the task is deleted
+			int generation;
+		};
+
+		RoutineCompiler();
+
+		~RoutineCompiler();
+
+		void queue(Task *task);
+		Task *retrieve();   // Returns a compiled task to be deleted by the caller, or null
+		void discard();     // Drops queued and compiled tasks, including the one in progress
+
+	private:
+		static void threadFunction(void *parameters);
+		void compileLoop();
+
+		Thread *thread;
+		Event *event;
+
+		BackoffLock mutex;
+		std::list<Task*> pending;
+		std::list<Task*> completed;
+		int generation;
+		volatile bool exit;
+	};
+}
+
+#endif   // sw_RoutineCompiler_hpp
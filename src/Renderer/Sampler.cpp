@@ -16,6 +16,8 @@
 #include "Surface.hpp"
 #include "CPUID.hpp"
 #include "PixelRoutine.hpp"
+#include "SamplerCore.hpp"
+#include "RoutineCache.hpp"
 #include "Debug.hpp"
 
 #include <memory.h>
@@ -23,14 +25,39 @@
 
 namespace sw
 {
+	extern bool pipelineProfiling;
+
+	bool precacheSampler = false;
+
 	FilterType Sampler::maximumTextureFilterQuality = FILTER_LINEAR;
 	MipmapType Sampler::maximumMipmapFilterQuality = MIPMAP_POINT;
 
+	// Process-wide, the routines don't depend on the renderer. Created by the first sampler routine
+	// lookup, after the renderer has been configured.
+	static RoutineCache<Sampler::RoutineState> *getRoutineCache()
+	{
+		static RoutineCache<Sampler::RoutineState> *routineCache = new RoutineCache<Sampler::RoutineState>(1024, precacheSampler ? "sw-sampler" : 0, "sw-sampler");
+
+		return routineCache;
+	}
+
 	Sampler::State::State()
 	{
 		memset(this, 0, sizeof(State));
 	}
 
+	Sampler::RoutineState::RoutineState()
+	{
+		// The state zeroes its own padding, and there's none around the method, so the bytes hashed are defined
+		method = SAMPLE_FIXED;
+		hash = 0;
+	}
+
+	bool Sampler::RoutineState::operator==(const RoutineState &routineState) const
+	{
+		return hash == routineState.hash && method == routineState.method && memcmp(&state, &routineState.state, sizeof(State)) == 0;
+	}
+
 	Sampler::Sampler()
 	{
 		// FIXME: Mipmap::init
@@ -88,14 +115,44 @@ namespace sw
 			state.hasNPOTTexture = hasNPOTTexture();
 			state.sRGB = sRGB && Surface::isSRGBreadable(externalTextureFormat);
 
-			#if PERF_PROFILE
+			if(pipelineProfiling)
+			{
+				state.profile = true;
 				state.compressedFormat = Surface::isCompressed(externalTextureFormat);
-			#endif
+			}
 		}
 
 		return state;
 	}
 
+	Routine *Sampler::routine(const State &state, SamplerMethod method)
+	{
+		RoutineState routineState;
+		routineState.state = state;
+		routineState.method = method;
+
+		const unsigned char *key = (const unsigned char*)&routineState;
+		unsigned int hash = 2166136261;   // FNV-1a
+
+		for(int i = 0; i < (int)OFFSET(RoutineState,hash); i++)
+		{
+			hash = (hash ^ key[i]) * 16777619;
+		}
+
+		routineState.hash = hash;
+
+		RoutineCache<RoutineState> *routineCache = getRoutineCache();
+		Routine *routine = routineCache->acquire(routineState);
+
+		if(!routine)
+		{
+			routine = SamplerCore::generate(state, method);
+			routine = routineCache->acquire(routineState, routine);
+		}
+
+		return routine;
+	}
+
 	void Sampler::setTextureLevel(int face, int level, Surface *surface, TextureType type)
 	{
 		if(surface)
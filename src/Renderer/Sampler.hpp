@@ -113,6 +113,21 @@ namespace sw
 		ADDRESSING_LAST = ADDRESSING_BORDER
 	};
 
+	// Sampler routines are generated for each state and method, and called by the shader routines
+	enum SamplerMethod : unsigned int
+	{
+		SAMPLE_FIXED,            // 4.12 fixed-point result, for fixed-function and ps_1_x
+		SAMPLE_IMPLICIT,
+		SAMPLE_BIAS,
+		SAMPLE_GRADIENTS,
+		SAMPLE_GRADIENTS_BIAS,
+		SAMPLE_LOD,
+
+		SAMPLER_METHOD_COUNT
+	};
+
+	class Routine;
+
 	class Sampler
 	{
 	public:
@@ -129,10 +144,20 @@ namespace sw
 			MipmapType mipmapFilter        : BITS(FILTER_LAST);
 			bool hasNPOTTexture	           : 1;
 			bool sRGB                      : 1;
+			bool profile                   : 1;   // Counts texture operations
+			bool compressedFormat          : 1;   // Only set when profiling
+		};
 
-			#if PERF_PROFILE
-			bool compressedFormat          : 1;
-			#endif
+		struct RoutineState
+		{
+			RoutineState();
+
+			bool operator==(const RoutineState &state) const;
+
+			State state;
+			SamplerMethod method;
+
+			unsigned int hash;
 		};
 
 		Sampler();
@@ -164,6 +189,8 @@ namespace sw
 
 		const Texture &getTextureData();
 
+		static Routine *routine(const State &state, SamplerMethod method);   // Returns the routine bound, for the caller to unbind
+
 	private:
 		MipmapType mipmapFilter() const;
 		bool hasNPOTTexture() const;
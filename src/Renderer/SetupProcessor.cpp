@@ -23,17 +23,40 @@ namespace sw
 {
 	extern bool complementaryDepthBuffer;
 	extern bool fullPixelPositionRegister;
+	extern bool halfSpaceRasterization;
+
+	extern bool backgroundCompilation;
+	extern int recompileThreshold;
 
 	bool precacheSetup = false;
 
+	class SetupRoutineTask : public RoutineCompiler::Task
+	{
+	public:
+		SetupRoutineTask(const SetupProcessor::State &state) : state(state)
+		{
+		}
+
+		const SetupProcessor::State state;
+
+	protected:
+		virtual Routine *compile()
+		{
+			SetupRoutine generator(state);
+			generator.generate(true);
+
+			return generator.getRoutine();
+		}
+	};
+
 	unsigned int SetupProcessor::States::computeHash()
 	{
 		unsigned int *state = (unsigned int*)this;
-		unsigned int hash = 0;
+		unsigned int hash = 2166136261;   // FNV-1a on 32-bit words, well distributed for indexing the routine cache
 
 		for(int i = 0; i < sizeof(States) / 4; i++)
 		{
-			hash ^= state[i];
+			hash = (hash ^ state[i]) * 16777619;
 		}
 
 		return hash;
@@ -56,13 +79,17 @@ namespace sw
 
 	SetupProcessor::SetupProcessor(Context *context) : context(context)
 	{
+		routineCompiler = 0;
 		routineCache = 0;
 		setRoutineCacheSize(1024);
 	}
 
 	SetupProcessor::~SetupProcessor()
 	{
-		delete routineCache;
+		delete routineCompiler;
+		routineCompiler = 0;
+
+		RoutineCache<State>::release(routineCache);
 		routineCache = 0;
 	}
 
@@ -89,6 +116,7 @@ namespace sw
 		state.pointSizeRegister = 0xF;   // No vertex point size
 
 		state.multiSample = context->getMultiSampleCount();
+		state.halfSpace = halfSpaceRasterization;
 
 		if(context->vertexShader)
 		{
@@ -220,16 +248,35 @@ namespace sw
 
 	Routine *SetupProcessor::routine(const State &state)
 	{
-		Routine *routine = routineCache->query(state);
+		if(routineCompiler)
+		{
+			while(RoutineCompiler::Task *task = routineCompiler->retrieve())
+			{
+				routineCache->replace(static_cast<SetupRoutineTask*>(task)->state, task->getRoutine());
+				delete task;
+			}
+		}
+
+		Routine *routine = routineCache->acquire(state);
 
 		if(!routine)
 		{
 			SetupRoutine *generator = new SetupRoutine(state);
-			generator->generate();
+			generator->generate(!backgroundCompilation);
 			routine = generator->getRoutine();
 			delete generator;
 
-			routineCache->add(state, routine);
+			routine = routineCache->acquire(state, routine);
+		}
+
+		if(!routine->isOptimized() && routine->use() == recompileThreshold)
+		{
+			if(!routineCompiler)
+			{
+				routineCompiler = new RoutineCompiler();
+			}
+
+			routineCompiler->queue(new SetupRoutineTask(state));
 		}
 
 		return routine;
@@ -237,7 +284,15 @@ namespace sw
 
 	void SetupProcessor::setRoutineCacheSize(int cacheSize)
 	{
-		delete routineCache;
-		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precacheSetup ? "sw-setup" : 0);
+		if(routineCompiler)
+		{
+			routineCompiler->discard();
+		}
+
+		RoutineCache<State>::release(routineCache);
+
+		int size = clamp(cacheSize, 1, 65536);
+		const char *precache = precacheSetup ? "sw-setup" : 0;
+		routineCache = sharedRoutineCache ? RoutineCache<State>::share(size, precache, "sw-setup") : new RoutineCache<State>(size, precache, "sw-setup");
 	}
 }
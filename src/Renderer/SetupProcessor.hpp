@@ -14,6 +14,7 @@
 
 #include "Context.hpp"
 #include "RoutineCache.hpp"
+#include "RoutineCompiler.hpp"
 #include "Shader/VertexShader.hpp"
 #include "Shader/PixelShader.hpp"
 #include "Common/Types.hpp"
@@ -49,6 +50,7 @@ namespace sw
 			bool slopeDepthBias            : 1;
 			bool vFace                     : 1;
 			unsigned int multiSample       : 3;   // 1, 2 or 4
+			bool halfSpace                 : 1;   // Edge functions instead of the outline
 
 			struct Gradient
 			{
@@ -88,7 +90,7 @@ namespace sw
 
 	protected:
 		State update() const;
-		Routine *routine(const State &state);
+		Routine *routine(const State &state);   // Bound, for the draw call to unbind
 
 		void setRoutineCacheSize(int cacheSize);
 
@@ -99,6 +101,7 @@ namespace sw
 		Context *const context;
 
 		RoutineCache<State> *routineCache;
+		RoutineCompiler *routineCompiler;
 	};
 }
 
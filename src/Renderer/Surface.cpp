@@ -18,11 +18,14 @@
 #include "Common/Memory.hpp"
 #include "Common/CPUID.hpp"
 #include "Common/Resource.hpp"
+#include "Common/Thread.hpp"
+#include "Common/MutexLock.hpp"
 #include "Common/Debug.hpp"
 #include "Reactor/Reactor.hpp"
 
 #include <xmmintrin.h>
 #include <emmintrin.h>
+#include <float.h>
 
 #undef min
 #undef max
@@ -830,6 +833,12 @@ namespace sw
 		stencil.lock = LOCK_UNLOCKED;
 		stencil.dirty = false;
 
+		hiZ = 0;
+		tileState = 0;
+		internalClear = 0;
+		stencilClear = 0;
+		clearDeferred = false;
+		unresolved = false;
 		dirtyMipmaps = true;
 		paletteUsed = 0;
 	}
@@ -880,8 +889,22 @@ namespace sw
 		stencil.lock = LOCK_UNLOCKED;
 		stencil.dirty = false;
 
+		hiZ = 0;
+		tileState = 0;
+		internalClear = 0;
+		stencilClear = 0;
+		clearDeferred = false;
+		unresolved = false;
 		dirtyMipmaps = true;
 		paletteUsed = 0;
+
+		if(renderTarget && depth > 1)   // Multisampled
+		{
+			int columns = (width + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
+			int rows = (height + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
+
+			tileState = (unsigned char*)allocateZero(columns * rows);
+		}
 	}
 
 	Surface::~Surface()
@@ -906,6 +929,8 @@ namespace sw
 		}
 
 		deallocate(stencil.buffer);
+		deallocate(hiZ);
+		deallocate(tileState);
 
 		external.buffer = 0;
 		internal.buffer = 0;
@@ -916,6 +941,11 @@ namespace sw
 	{
 		resource->lock(client);
 
+		if(clearDeferred && client != MANAGED)
+		{
+			fillClearedTiles();
+		}
+
 		if(!external.buffer)
 		{
 			if(internal.buffer && identicalFormats())
@@ -946,6 +976,7 @@ namespace sw
 		case LOCK_READWRITE:
 		case LOCK_DISCARD:
 			dirtyMipmaps = true;
+			invalidateHiZ();
 			break;
 		default:
 			ASSERT(false);
@@ -980,6 +1011,11 @@ namespace sw
 			}
 		}
 
+		if(clearDeferred && client != MANAGED && lock != LOCK_UNLOCKED)
+		{
+			fillClearedTiles();
+		}
+
 		// FIXME: WHQL requires conversion to lower external precision and back
 		if(logPrecision >= WHQL)
 		{
@@ -1025,6 +1061,12 @@ namespace sw
 		case LOCK_READWRITE:
 		case LOCK_DISCARD:
 			dirtyMipmaps = true;
+
+			if(client != MANAGED)   // The renderer keeps the hierarchical depth and the tiles to resolve up to date
+			{
+				invalidateHiZ();
+				unresolved = true;
+			}
 			break;
 		default:
 			ASSERT(false);
@@ -1054,6 +1096,11 @@ namespace sw
 			stencil.buffer = allocateBuffer(stencil.width, stencil.height, stencil.depth, stencil.format);
 		}
 
+		if(clearDeferred && client != MANAGED)
+		{
+			fillClearedTiles();
+		}
+
 		return stencil.lockRect(0, 0, front, LOCK_READWRITE);   // FIXME
 	}
 
@@ -1064,6 +1111,192 @@ namespace sw
 		stencil.unlockRect();
 	}
 
+	float *Surface::getHiZ()
+	{
+		if(!hiZ)
+		{
+			int height = (internal.height + (1 << BLOCK_SIZE_LOG2) - 1) >> BLOCK_SIZE_LOG2;
+
+			hiZ = (float*)allocate(height * getHiZPitchB());
+			invalidateHiZ();
+		}
+
+		return hiZ;
+	}
+
+	void Surface::discardHiZ()
+	{
+		if(hiZ)
+		{
+			resource->lock(PUBLIC);
+			deallocate(hiZ);
+			hiZ = 0;
+			resource->unlock();
+		}
+	}
+
+	void Surface::touchTile(int tileX, int tileY)
+	{
+		int columns = (internal.width + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
+		int rows = (internal.height + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
+
+		if(tileX < columns && tileY < rows)
+		{
+			unsigned char &state = tileState[tileY * columns + tileX];
+
+			if(state & (CLEAR_INTERNAL | CLEAR_STENCIL))
+			{
+				fillTile(state, tileX, tileY);
+				state &= ~(CLEAR_INTERNAL | CLEAR_STENCIL);
+			}
+
+			if(renderTarget && internal.depth > 1)   // Rendered to, filling alone leaves the samples equal
+			{
+				state |= UNRESOLVED;
+			}
+		}
+	}
+
+	void Surface::touchTiles()
+	{
+		if(clearDeferred)
+		{
+			resource->lock(PUBLIC);   // Wait for the renderer to stop filling tiles
+			fillClearedTiles();
+			resource->unlock();
+		}
+
+		unresolved = true;
+	}
+
+	bool Surface::deferClear(TileState buffer, unsigned int value)
+	{
+		Buffer &target = buffer == CLEAR_INTERNAL ? internal : stencil;
+
+		// Textures can be sampled without being locked for reading
+		if(hasParent || !renderTarget || !target.buffer || (buffer == CLEAR_INTERNAL && target.bytes != 4))
+		{
+			return false;
+		}
+
+		int columns = (internal.width + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
+		int rows = (internal.height + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
+
+		resource->lock(PUBLIC);   // Wait for the renderer to stop using the tiles
+
+		if(!tileState)
+		{
+			tileState = (unsigned char*)allocateZero(columns * rows);
+		}
+
+		if(buffer == CLEAR_INTERNAL)   // All samples become equal
+		{
+			for(int i = 0; i < columns * rows; i++)
+			{
+				tileState[i] = (tileState[i] & ~UNRESOLVED) | CLEAR_INTERNAL;
+			}
+
+			internalClear = value;
+			unresolved = false;
+		}
+		else
+		{
+			for(int i = 0; i < columns * rows; i++)
+			{
+				tileState[i] |= CLEAR_STENCIL;
+			}
+
+			stencilClear = value;
+		}
+
+		clearDeferred = true;
+		target.dirty = true;
+		dirtyMipmaps = true;
+
+		resource->unlock();
+
+		return true;
+	}
+
+	void Surface::fillClearedTiles()
+	{
+		int columns = (internal.width + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
+		int rows = (internal.height + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
+
+		for(int tileY = 0; tileY < rows; tileY++)
+		{
+			for(int tileX = 0; tileX < columns; tileX++)
+			{
+				unsigned char &state = tileState[tileY * columns + tileX];
+
+				if(state & (CLEAR_INTERNAL | CLEAR_STENCIL))
+				{
+					fillTile(state, tileX, tileY);
+					state &= ~(CLEAR_INTERNAL | CLEAR_STENCIL);
+				}
+			}
+		}
+
+		clearDeferred = false;
+	}
+
+	void Surface::fillTile(int buffers, int tileX, int tileY)
+	{
+		if(buffers & CLEAR_INTERNAL)
+		{
+			bool quadLayout = isDepth(internal.format) &&
+			                  internal.format != FORMAT_D32F_LOCKABLE &&
+			                  internal.format != FORMAT_D32FS8_TEXTURE &&
+			                  internal.format != FORMAT_D32FS8_SHADOW;
+
+			fillTile(internal, internalClear, quadLayout, tileX, tileY);
+		}
+
+		if(buffers & CLEAR_STENCIL)
+		{
+			fillTile(stencil, stencilClear, true, tileX, tileY);
+		}
+	}
+
+	void Surface::fillTile(Buffer &buffer, unsigned int value, bool quadLayout, int tileX, int tileY)
+	{
+		int x0 = tileX << TILE_SIZE_LOG2;
+		int y0 = tileY << TILE_SIZE_LOG2;
+		int x1 = min(x0 + (1 << TILE_SIZE_LOG2), buffer.width);
+		int y1 = min(y0 + (1 << TILE_SIZE_LOG2), buffer.height);
+
+		for(int z = 0; z < buffer.depth; z++)
+		{
+			unsigned char *slice = (unsigned char*)buffer.buffer + z * buffer.sliceB;
+
+			if(!quadLayout)
+			{
+				for(int y = y0; y < y1; y++)
+				{
+					memfill4(slice + y * buffer.pitchB + x0 * buffer.bytes, value, (x1 - x0) * buffer.bytes);
+				}
+			}
+			else   // Pairs of rows are interleaved per quad, and tiles start on even coordinates
+			{
+				for(int y = y0; y < y1; y += 2)
+				{
+					memfill4(slice + y * buffer.pitchB + x0 * 2 * buffer.bytes, value, (((x1 + 1) & ~1) - x0) * 2 * buffer.bytes);
+				}
+			}
+		}
+	}
+
+	void Surface::invalidateHiZ()
+	{
+		if(hiZ)
+		{
+			int height = (internal.height + (1 << BLOCK_SIZE_LOG2) - 1) >> BLOCK_SIZE_LOG2;
+			float unknown = FLT_MAX;   // Never occludes
+
+			memfill4(hiZ, (int&)unknown, height * getHiZPitchB());
+		}
+	}
+
 	int Surface::bytes(Format format)
 	{
 		switch(format)
@@ -2472,11 +2705,40 @@ namespace sw
 		const bool entire = x0 == 0 && y0 == 0 && width == internal.width && height == internal.height;
 		const Lock lock = entire ? LOCK_DISCARD : LOCK_WRITEONLY;
 
+		if(entire)   // Filled when the tiles get rendered to or locked
+		{
+			switch(internal.format)
+			{
+			case FORMAT_X8R8G8B8:
+			case FORMAT_A8R8G8B8:
+				if((rgbaMask == 0xF || (internal.format == FORMAT_X8R8G8B8 && rgbaMask == 0x7)) && deferClear(CLEAR_INTERNAL, colorARGB))
+				{
+					return;
+				}
+				break;
+			case FORMAT_X8B8G8R8:
+			case FORMAT_A8B8G8R8:
+				{
+					unsigned int colorABGR = (colorARGB & 0xFF00FF00) | ((colorARGB & 0x00FF0000) >> 16) | ((colorARGB & 0x000000FF) << 16);
+
+					if((rgbaMask == 0xF || (internal.format == FORMAT_X8B8G8R8 && rgbaMask == 0x7)) && deferClear(CLEAR_INTERNAL, colorABGR))
+					{
+						return;
+					}
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
 		int x1 = x0 + width;
 		int y1 = y0 + height;
 
 	//	if(lockable || !quadLayoutEnabled)
 		{
+			resource->lock(PUBLIC);
+			bool wasUnresolved = unresolved;   // Every sample gets the same color, so the tiles to resolve stay the same
 			unsigned char *buffer = (unsigned char*)lockInternal(x0, y0, 0, lock, PUBLIC);
 
 			for(int z = 0; z < internal.depth; z++)
@@ -2708,7 +2970,9 @@ namespace sw
 				buffer += internal.sliceB;
 			}
 
+			unresolved = wasUnresolved;
 			unlockInternal();
+			resource->unlock();
 		}
 	/*	else
 		{
@@ -2840,99 +3104,120 @@ namespace sw
 		int x1 = x0 + width;
 		int y1 = y0 + height;
 
-		if(internal.format == FORMAT_D32F_LOCKABLE ||
-		   internal.format == FORMAT_D32FS8_TEXTURE ||
-		   internal.format == FORMAT_D32FS8_SHADOW)
+		const bool quadLayout = internal.format != FORMAT_D32F_LOCKABLE &&
+		                        internal.format != FORMAT_D32FS8_TEXTURE &&
+		                        internal.format != FORMAT_D32FS8_SHADOW;
+
+		if(quadLayout && complementaryDepthBuffer)
 		{
-			float *target = (float*)lockInternal(0, 0, 0, lock, PUBLIC) + x0 + width2 * y0;
+			depth = 1 - depth;
+		}
 
-			for(int z = 0; z < internal.depth; z++)
+		if(!entire || !deferClear(CLEAR_INTERNAL, (unsigned int&)depth))   // Otherwise filled when the tiles get rendered to or locked
+		{
+			if(!quadLayout)
 			{
-				for(int y = y0; y < y1; y++)
+				float *target = (float*)lockInternal(0, 0, 0, lock, PUBLIC) + x0 + width2 * y0;
+
+				for(int z = 0; z < internal.depth; z++)
 				{
-					memfill4(target, (int&)depth, 4 * width);
-					target += width2;
+					for(int y = y0; y < y1; y++)
+					{
+						memfill4(target, (int&)depth, 4 * width);
+						target += width2;
+					}
 				}
-			}
 
-			unlockInternal();
-		}
-		else   // Quad layout
-		{
-			if(complementaryDepthBuffer)
-			{
-				depth = 1 - depth;
+				unlockInternal();
 			}
-
-			float *buffer = (float*)lockInternal(0, 0, 0, lock, PUBLIC);
-
-			for(int z = 0; z < internal.depth; z++)
+			else   // Quad layout
 			{
-				for(int y = y0; y < y1; y++)
+				float *buffer = (float*)lockInternal(0, 0, 0, lock, PUBLIC);
+
+				for(int z = 0; z < internal.depth; z++)
 				{
-					float *target = buffer + (y & ~1) * width2 + (y & 1) * 2;
-			
-					if((y & 1) == 0 && y + 1 < y1)   // Fill quad line at once
+					for(int y = y0; y < y1; y++)
 					{
-						if((x0 & 1) != 0)
+						float *target = buffer + (y & ~1) * width2 + (y & 1) * 2;
+				
+						if((y & 1) == 0 && y + 1 < y1)   // Fill quad line at once
 						{
-							target[(x0 & ~1) * 2 + 1] = depth;
-							target[(x0 & ~1) * 2 + 3] = depth;
-						}
+							if((x0 & 1) != 0)
+							{
+								target[(x0 & ~1) * 2 + 1] = depth;
+								target[(x0 & ~1) * 2 + 3] = depth;
+							}
 
-					//	for(int x2 = ((x0 + 1) & ~1) * 2; x2 < x1 * 2; x2 += 4)
-					//	{
-					//		target[x2 + 0] = depth;
-					//		target[x2 + 1] = depth;
-					//		target[x2 + 2] = depth;
-					//		target[x2 + 3] = depth;
-					//	}
-
-					//	__asm
-					//	{
-					//		movss xmm0, depth
-					//		shufps xmm0, xmm0, 0x00
-					//
-					//		mov eax, x0
-					//		add eax, 1
-					//		and eax, 0xFFFFFFFE
-					//		cmp eax, x1
-					//		jge qEnd
-					//
-					//		mov edi, target
-					//
-					//	qLoop:
-					//		movntps [edi+8*eax], xmm0
-					//
-					//		add eax, 2
-					//		cmp eax, x1
-					//		jl qLoop
-					//	qEnd:
-					//	}
-
-						memfill4(&target[((x0 + 1) & ~1) * 2], (int&)depth, 8 * ((x1 & ~1) - ((x0 + 1) & ~1)));
-
-						if((x1 & 1) != 0)
-						{
-							target[(x1 & ~1) * 2 + 0] = depth;
-							target[(x1 & ~1) * 2 + 2] = depth;
-						}
+						//	for(int x2 = ((x0 + 1) & ~1) * 2; x2 < x1 * 2; x2 += 4)
+						//	{
+						//		target[x2 + 0] = depth;
+						//		target[x2 + 1] = depth;
+						//		target[x2 + 2] = depth;
+						//		target[x2 + 3] = depth;
+						//	}
+
+						//	__asm
+						//	{
+						//		movss xmm0, depth
+						//		shufps xmm0, xmm0, 0x00
+						//
+						//		mov eax, x0
+						//		add eax, 1
+						//		and eax, 0xFFFFFFFE
+						//		cmp eax, x1
+						//		jge qEnd
+						//
+						//		mov edi, target
+						//
+						//	qLoop:
+						//		movntps [edi+8*eax], xmm0
+						//
+						//		add eax, 2
+						//		cmp eax, x1
+						//		jl qLoop
+						//	qEnd:
+						//	}
+
+							memfill4(&target[((x0 + 1) & ~1) * 2], (int&)depth, 8 * ((x1 & ~1) - ((x0 + 1) & ~1)));
 
-						y++;
-					}
-					else
-					{
-						for(int x = x0; x < x1; x++)
+							if((x1 & 1) != 0)
+							{
+								target[(x1 & ~1) * 2 + 0] = depth;
+								target[(x1 & ~1) * 2 + 2] = depth;
+							}
+
+							y++;
+						}
+						else
 						{
-							target[(x & ~1) * 2 + (x & 1)] = depth;
+							for(int x = x0; x < x1; x++)
+							{
+								target[(x & ~1) * 2 + (x & 1)] = depth;
+							}
 						}
 					}
+
+					buffer += internal.sliceP;
 				}
 
-				buffer += internal.sliceP;
+				unlockInternal();
 			}
+		}
 
-			unlockInternal();
+		if(hiZ)   // Invalidated by the lock, except for the blocks cleared entirely
+		{
+			const int size = 1 << BLOCK_SIZE_LOG2;
+			float *row = (float*)((char*)hiZ + ((y0 + size - 1) >> BLOCK_SIZE_LOG2) * getHiZPitchB());
+
+			for(int y = (y0 + size - 1) & -size; y < y1 && min(y + size, internal.height) <= y1; y += size)
+			{
+				for(int x = (x0 + size - 1) & -size; x < x1 && min(x + size, internal.width) <= x1; x += size)
+				{
+					row[x >> BLOCK_SIZE_LOG2] = depth;
+				}
+
+				row = (float*)((char*)row + getHiZPitchB());
+			}
 		}
 	}
 
@@ -2960,6 +3245,13 @@ namespace sw
 		unsigned int fill = maskedS;
 		fill = fill | (fill << 8) | (fill << 16) + (fill << 24);
 
+		const bool entire = x0 == 0 && y0 == 0 && width == internal.width && height == internal.height;
+
+		if(entire && mask == 0xFF && deferClear(CLEAR_STENCIL, fill))   // Filled when the tiles get rendered to or locked
+		{
+			return;
+		}
+
 		if(false)
 		{
 			char *target = (char*)lockStencil(0, PUBLIC) + x0 + width2 * y0;
@@ -3351,1799 +3643,432 @@ namespace sw
 		Surface::paletteID++;
 	}
 
-	void Surface::resolve()
+	// Threads which help the calling thread resolve. They're started by the first resolve with
+	// enough work for them, and parked in between, so resolves don't pay for creating threads.
+	// They're ended along with the threads of the last renderer, not on static destruction, which
+	// in a DLL runs under the loader lock where joining threads can deadlock.
+	class ResolvePool
 	{
-		if(internal.depth <= 1 || !internal.dirty || !renderTarget || internal.format == FORMAT_NULL)
-		{
-			return;
-		}
+	public:
+		enum {MAX_WORKERS = 15};   // Besides the calling thread
 
-		void *source = internal.lockRect(0, 0, 0, LOCK_READWRITE);
-
-		int quality = internal.depth;
-		int width = internal.width;
-		int height = internal.height;
-		int pitch = internal.pitchB;
-		int slice = internal.sliceB;
-
-		unsigned char *source0 = (unsigned char*)source;
-		unsigned char *source1 = source0 + slice;
-		unsigned char *source2 = source1 + slice;
-		unsigned char *source3 = source2 + slice;
-		unsigned char *source4 = source3 + slice;
-		unsigned char *source5 = source4 + slice;
-		unsigned char *source6 = source5 + slice;
-		unsigned char *source7 = source6 + slice;
-		unsigned char *source8 = source7 + slice;
-		unsigned char *source9 = source8 + slice;
-		unsigned char *sourceA = source9 + slice;
-		unsigned char *sourceB = sourceA + slice;
-		unsigned char *sourceC = sourceB + slice;
-		unsigned char *sourceD = sourceC + slice;
-		unsigned char *sourceE = sourceD + slice;
-		unsigned char *sourceF = sourceE + slice;
-
-		if(internal.format == FORMAT_X8R8G8B8 || internal.format == FORMAT_A8R8G8B8 || internal.format == FORMAT_X8B8G8R8 || internal.format == FORMAT_A8B8G8R8)
-		{
-			if(CPUID::supportsSSE2() && (width % 4) == 0)
-			{
-				if(internal.depth == 2)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-							
-							c0 = _mm_avg_epu8(c0, c1);
+		ResolvePool();
 
-							_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
-						}
+		~ResolvePool();
 
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-							__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-							__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
-							
-							c0 = _mm_avg_epu8(c0, c1);
-							c2 = _mm_avg_epu8(c2, c3);
-							c0 = _mm_avg_epu8(c0, c2);
+		void start(int threadCount);
+		void stop();
 
-							_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
-						}
+		// Runs the function on the calling thread and on up to the given number of workers at once,
+		// returning when all are done. Runs it on the calling thread only when another resolve
+		// is using the pool, or no renderer has started its threads.
+		void run(void (*function)(void *parameters), void *parameters, int workers);
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-							__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-							__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
-							__m128i c4 = _mm_load_si128((__m128i*)(source4 + 4 * x));
-							__m128i c5 = _mm_load_si128((__m128i*)(source5 + 4 * x));
-							__m128i c6 = _mm_load_si128((__m128i*)(source6 + 4 * x));
-							__m128i c7 = _mm_load_si128((__m128i*)(source7 + 4 * x));
-							
-							c0 = _mm_avg_epu8(c0, c1);
-							c2 = _mm_avg_epu8(c2, c3);
-							c4 = _mm_avg_epu8(c4, c5);
-							c6 = _mm_avg_epu8(c6, c7);
-							c0 = _mm_avg_epu8(c0, c2);
-							c4 = _mm_avg_epu8(c4, c6);
-							c0 = _mm_avg_epu8(c0, c4);
-
-							_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
-						}
+	private:
+		struct Worker
+		{
+			ResolvePool *pool;
+			Thread *thread;
+			Event resume;
+		};
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
-				}
-				else if(internal.depth == 16)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-							__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-							__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
-							__m128i c4 = _mm_load_si128((__m128i*)(source4 + 4 * x));
-							__m128i c5 = _mm_load_si128((__m128i*)(source5 + 4 * x));
-							__m128i c6 = _mm_load_si128((__m128i*)(source6 + 4 * x));
-							__m128i c7 = _mm_load_si128((__m128i*)(source7 + 4 * x));
-							__m128i c8 = _mm_load_si128((__m128i*)(source8 + 4 * x));
-							__m128i c9 = _mm_load_si128((__m128i*)(source9 + 4 * x));
-							__m128i cA = _mm_load_si128((__m128i*)(sourceA + 4 * x));
-							__m128i cB = _mm_load_si128((__m128i*)(sourceB + 4 * x));
-							__m128i cC = _mm_load_si128((__m128i*)(sourceC + 4 * x));
-							__m128i cD = _mm_load_si128((__m128i*)(sourceD + 4 * x));
-							__m128i cE = _mm_load_si128((__m128i*)(sourceE + 4 * x));
-							__m128i cF = _mm_load_si128((__m128i*)(sourceF + 4 * x));
-
-							c0 = _mm_avg_epu8(c0, c1);
-							c2 = _mm_avg_epu8(c2, c3);
-							c4 = _mm_avg_epu8(c4, c5);
-							c6 = _mm_avg_epu8(c6, c7);
-							c8 = _mm_avg_epu8(c8, c9);
-							cA = _mm_avg_epu8(cA, cB);
-							cC = _mm_avg_epu8(cC, cD);
-							cE = _mm_avg_epu8(cE, cF);
-							c0 = _mm_avg_epu8(c0, c2);
-							c4 = _mm_avg_epu8(c4, c6);
-							c8 = _mm_avg_epu8(c8, cA);
-							cC = _mm_avg_epu8(cC, cE);
-							c0 = _mm_avg_epu8(c0, c4);
-							c8 = _mm_avg_epu8(c8, cC);
-							c0 = _mm_avg_epu8(c0, c8);
-
-							_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
-						}
+		static void workerFunction(void *parameters);
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
-					}
-				}
-				else ASSERT(false);
-			}
-			else
-			{
-				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7F7F7F7F) + (((x) ^ (y)) & 0x01010101))
+		MutexLock mutex;
+		Worker worker[MAX_WORKERS];
+		int workerCount;   // Started so far
+		int users;         // Renderers with started threads
+		int threadCount;   // Most threads used by one of them
 
-				if(internal.depth == 2)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
+		void (*volatile function)(void *parameters);
+		void *volatile parameters;
+		volatile int active;   // Workers still running the function
+		Event finished;
+		volatile bool exitWorkers;
+	};
 
-							c0 = AVERAGE(c0, c1);
+	ResolvePool::ResolvePool()
+	{
+		workerCount = 0;
+		users = 0;
+		threadCount = 1;
+		function = 0;
+		parameters = 0;
+		active = 0;
+		exitWorkers = false;
+	}
 
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+	ResolvePool::~ResolvePool()
+	{
+		// Workers of a renderer that was never destroyed are left to the process exit
+	}
 
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
-							unsigned int c2 = *(unsigned int*)(source2 + 4 * x);
-							unsigned int c3 = *(unsigned int*)(source3 + 4 * x);
+	void ResolvePool::start(int threadCount)
+	{
+		mutex.lock();
 
-							c0 = AVERAGE(c0, c1);
-							c2 = AVERAGE(c2, c3);
-							c0 = AVERAGE(c0, c2);
+		users++;
+		this->threadCount = max(this->threadCount, threadCount);
 
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+		mutex.unlock();
+	}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
-							unsigned int c2 = *(unsigned int*)(source2 + 4 * x);
-							unsigned int c3 = *(unsigned int*)(source3 + 4 * x);
-							unsigned int c4 = *(unsigned int*)(source4 + 4 * x);
-							unsigned int c5 = *(unsigned int*)(source5 + 4 * x);
-							unsigned int c6 = *(unsigned int*)(source6 + 4 * x);
-							unsigned int c7 = *(unsigned int*)(source7 + 4 * x);
-
-							c0 = AVERAGE(c0, c1);
-							c2 = AVERAGE(c2, c3);
-							c4 = AVERAGE(c4, c5);
-							c6 = AVERAGE(c6, c7);
-							c0 = AVERAGE(c0, c2);
-							c4 = AVERAGE(c4, c6);
-							c0 = AVERAGE(c0, c4);
-
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+	void ResolvePool::stop()
+	{
+		mutex.lock();   // Waits for a resolve using the workers
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
-				}
-				else if(internal.depth == 16)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
-							unsigned int c2 = *(unsigned int*)(source2 + 4 * x);
-							unsigned int c3 = *(unsigned int*)(source3 + 4 * x);
-							unsigned int c4 = *(unsigned int*)(source4 + 4 * x);
-							unsigned int c5 = *(unsigned int*)(source5 + 4 * x);
-							unsigned int c6 = *(unsigned int*)(source6 + 4 * x);
-							unsigned int c7 = *(unsigned int*)(source7 + 4 * x);
-							unsigned int c8 = *(unsigned int*)(source8 + 4 * x);
-							unsigned int c9 = *(unsigned int*)(source9 + 4 * x);
-							unsigned int cA = *(unsigned int*)(sourceA + 4 * x);
-							unsigned int cB = *(unsigned int*)(sourceB + 4 * x);
-							unsigned int cC = *(unsigned int*)(sourceC + 4 * x);
-							unsigned int cD = *(unsigned int*)(sourceD + 4 * x);
-							unsigned int cE = *(unsigned int*)(sourceE + 4 * x);
-							unsigned int cF = *(unsigned int*)(sourceF + 4 * x);
-
-							c0 = AVERAGE(c0, c1);
-							c2 = AVERAGE(c2, c3);
-							c4 = AVERAGE(c4, c5);
-							c6 = AVERAGE(c6, c7);
-							c8 = AVERAGE(c8, c9);
-							cA = AVERAGE(cA, cB);
-							cC = AVERAGE(cC, cD);
-							cE = AVERAGE(cE, cF);
-							c0 = AVERAGE(c0, c2);
-							c4 = AVERAGE(c4, c6);
-							c8 = AVERAGE(c8, cA);
-							cC = AVERAGE(cC, cE);
-							c0 = AVERAGE(c0, c4);
-							c8 = AVERAGE(c8, cC);
-							c0 = AVERAGE(c0, c8);
-
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
-
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
-					}
-				}
-				else ASSERT(false);
+		if(--users == 0)
+		{
+			exitWorkers = true;
 
-				#undef AVERAGE
+			for(int i = 0; i < workerCount; i++)
+			{
+				worker[i].resume.signal();
+				delete worker[i].thread;   // Joins
 			}
+
+			workerCount = 0;
+			threadCount = 1;
+			exitWorkers = false;
 		}
-		else if(internal.format == FORMAT_G16R16)
-		{
-			if(CPUID::supportsSSE2() && (width % 4) == 0)
-			{
-				if(internal.depth == 2)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-							
-							c0 = _mm_avg_epu16(c0, c1);
 
-							_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
-						}
+		mutex.unlock();
+	}
 
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-							__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-							__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
-							
-							c0 = _mm_avg_epu16(c0, c1);
-							c2 = _mm_avg_epu16(c2, c3);
-							c0 = _mm_avg_epu16(c0, c2);
+	void ResolvePool::run(void (*function)(void *parameters), void *parameters, int workers)
+	{
+		if(workers <= 0 || !mutex.attemptLock())
+		{
+			function(parameters);
 
-							_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
-						}
+			return;
+		}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-							__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-							__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
-							__m128i c4 = _mm_load_si128((__m128i*)(source4 + 4 * x));
-							__m128i c5 = _mm_load_si128((__m128i*)(source5 + 4 * x));
-							__m128i c6 = _mm_load_si128((__m128i*)(source6 + 4 * x));
-							__m128i c7 = _mm_load_si128((__m128i*)(source7 + 4 * x));
-							
-							c0 = _mm_avg_epu16(c0, c1);
-							c2 = _mm_avg_epu16(c2, c3);
-							c4 = _mm_avg_epu16(c4, c5);
-							c6 = _mm_avg_epu16(c6, c7);
-							c0 = _mm_avg_epu16(c0, c2);
-							c4 = _mm_avg_epu16(c4, c6);
-							c0 = _mm_avg_epu16(c0, c4);
-
-							_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
-						}
+		workers = min(workers, min(threadCount - 1, (int)MAX_WORKERS));
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
-				}
-				else if(internal.depth == 16)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-							__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-							__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
-							__m128i c4 = _mm_load_si128((__m128i*)(source4 + 4 * x));
-							__m128i c5 = _mm_load_si128((__m128i*)(source5 + 4 * x));
-							__m128i c6 = _mm_load_si128((__m128i*)(source6 + 4 * x));
-							__m128i c7 = _mm_load_si128((__m128i*)(source7 + 4 * x));
-							__m128i c8 = _mm_load_si128((__m128i*)(source8 + 4 * x));
-							__m128i c9 = _mm_load_si128((__m128i*)(source9 + 4 * x));
-							__m128i cA = _mm_load_si128((__m128i*)(sourceA + 4 * x));
-							__m128i cB = _mm_load_si128((__m128i*)(sourceB + 4 * x));
-							__m128i cC = _mm_load_si128((__m128i*)(sourceC + 4 * x));
-							__m128i cD = _mm_load_si128((__m128i*)(sourceD + 4 * x));
-							__m128i cE = _mm_load_si128((__m128i*)(sourceE + 4 * x));
-							__m128i cF = _mm_load_si128((__m128i*)(sourceF + 4 * x));
-
-							c0 = _mm_avg_epu16(c0, c1);
-							c2 = _mm_avg_epu16(c2, c3);
-							c4 = _mm_avg_epu16(c4, c5);
-							c6 = _mm_avg_epu16(c6, c7);
-							c8 = _mm_avg_epu16(c8, c9);
-							cA = _mm_avg_epu16(cA, cB);
-							cC = _mm_avg_epu16(cC, cD);
-							cE = _mm_avg_epu16(cE, cF);
-							c0 = _mm_avg_epu16(c0, c2);
-							c4 = _mm_avg_epu16(c4, c6);
-							c8 = _mm_avg_epu16(c8, cA);
-							cC = _mm_avg_epu16(cC, cE);
-							c0 = _mm_avg_epu16(c0, c4);
-							c8 = _mm_avg_epu16(c8, cC);
-							c0 = _mm_avg_epu16(c0, c8);
-
-							_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
-						}
+		if(workers <= 0)
+		{
+			mutex.unlock();
+			function(parameters);
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
-					}
-				}
-				else ASSERT(false);
-			}
-			else
-			{
-				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7FFF7FFF) + (((x) ^ (y)) & 0x00010001))
+			return;
+		}
 
-				if(internal.depth == 2)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
+		while(workerCount < workers)
+		{
+			worker[workerCount].pool = this;
+			worker[workerCount].thread = new Thread(workerFunction, &worker[workerCount]);
+			workerCount++;
+		}
 
-							c0 = AVERAGE(c0, c1);
+		this->function = function;
+		this->parameters = parameters;
+		active = workers;
 
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+		for(int i = 0; i < workers; i++)
+		{
+			worker[i].resume.signal();
+		}
 
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
-							unsigned int c2 = *(unsigned int*)(source2 + 4 * x);
-							unsigned int c3 = *(unsigned int*)(source3 + 4 * x);
+		function(parameters);
+		finished.wait();
 
-							c0 = AVERAGE(c0, c1);
-							c2 = AVERAGE(c2, c3);
-							c0 = AVERAGE(c0, c2);
+		mutex.unlock();
+	}
 
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+	void ResolvePool::workerFunction(void *parameters)
+	{
+		Worker *worker = static_cast<Worker*>(parameters);
+		ResolvePool *pool = worker->pool;
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
-							unsigned int c2 = *(unsigned int*)(source2 + 4 * x);
-							unsigned int c3 = *(unsigned int*)(source3 + 4 * x);
-							unsigned int c4 = *(unsigned int*)(source4 + 4 * x);
-							unsigned int c5 = *(unsigned int*)(source5 + 4 * x);
-							unsigned int c6 = *(unsigned int*)(source6 + 4 * x);
-							unsigned int c7 = *(unsigned int*)(source7 + 4 * x);
-
-							c0 = AVERAGE(c0, c1);
-							c2 = AVERAGE(c2, c3);
-							c4 = AVERAGE(c4, c5);
-							c6 = AVERAGE(c6, c7);
-							c0 = AVERAGE(c0, c2);
-							c4 = AVERAGE(c4, c6);
-							c0 = AVERAGE(c0, c4);
-
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+		while(true)
+		{
+			worker->resume.wait();
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
-				}
-				else if(internal.depth == 16)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
-							unsigned int c2 = *(unsigned int*)(source2 + 4 * x);
-							unsigned int c3 = *(unsigned int*)(source3 + 4 * x);
-							unsigned int c4 = *(unsigned int*)(source4 + 4 * x);
-							unsigned int c5 = *(unsigned int*)(source5 + 4 * x);
-							unsigned int c6 = *(unsigned int*)(source6 + 4 * x);
-							unsigned int c7 = *(unsigned int*)(source7 + 4 * x);
-							unsigned int c8 = *(unsigned int*)(source8 + 4 * x);
-							unsigned int c9 = *(unsigned int*)(source9 + 4 * x);
-							unsigned int cA = *(unsigned int*)(sourceA + 4 * x);
-							unsigned int cB = *(unsigned int*)(sourceB + 4 * x);
-							unsigned int cC = *(unsigned int*)(sourceC + 4 * x);
-							unsigned int cD = *(unsigned int*)(sourceD + 4 * x);
-							unsigned int cE = *(unsigned int*)(sourceE + 4 * x);
-							unsigned int cF = *(unsigned int*)(sourceF + 4 * x);
-
-							c0 = AVERAGE(c0, c1);
-							c2 = AVERAGE(c2, c3);
-							c4 = AVERAGE(c4, c5);
-							c6 = AVERAGE(c6, c7);
-							c8 = AVERAGE(c8, c9);
-							cA = AVERAGE(cA, cB);
-							cC = AVERAGE(cC, cD);
-							cE = AVERAGE(cE, cF);
-							c0 = AVERAGE(c0, c2);
-							c4 = AVERAGE(c4, c6);
-							c8 = AVERAGE(c8, cA);
-							cC = AVERAGE(cC, cE);
-							c0 = AVERAGE(c0, c4);
-							c8 = AVERAGE(c8, cC);
-							c0 = AVERAGE(c0, c8);
-
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+			if(pool->exitWorkers)
+			{
+				return;
+			}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
-					}
-				}
-				else ASSERT(false);
+			pool->function(pool->parameters);
 
-				#undef AVERAGE
+			if(atomicDecrement(&pool->active) == 0)
+			{
+				pool->finished.signal();
 			}
 		}
-		else if(internal.format == FORMAT_A16B16G16R16)
-		{
-			if(CPUID::supportsSSE2() && (width % 2) == 0)
-			{
-				if(internal.depth == 2)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 2)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 8 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 8 * x));
-							
-							c0 = _mm_avg_epu16(c0, c1);
+	}
 
-							_mm_store_si128((__m128i*)(source0 + 8 * x), c0);
-						}
+	static ResolvePool resolvePool;
 
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 2)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 8 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 8 * x));
-							__m128i c2 = _mm_load_si128((__m128i*)(source2 + 8 * x));
-							__m128i c3 = _mm_load_si128((__m128i*)(source3 + 8 * x));
-							
-							c0 = _mm_avg_epu16(c0, c1);
-							c2 = _mm_avg_epu16(c2, c3);
-							c0 = _mm_avg_epu16(c0, c2);
+	void Surface::startResolveThreads(int threadCount)
+	{
+		resolvePool.start(threadCount);
+	}
 
-							_mm_store_si128((__m128i*)(source0 + 8 * x), c0);
-						}
+	void Surface::stopResolveThreads()
+	{
+		resolvePool.stop();
+	}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 2)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 8 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 8 * x));
-							__m128i c2 = _mm_load_si128((__m128i*)(source2 + 8 * x));
-							__m128i c3 = _mm_load_si128((__m128i*)(source3 + 8 * x));
-							__m128i c4 = _mm_load_si128((__m128i*)(source4 + 8 * x));
-							__m128i c5 = _mm_load_si128((__m128i*)(source5 + 8 * x));
-							__m128i c6 = _mm_load_si128((__m128i*)(source6 + 8 * x));
-							__m128i c7 = _mm_load_si128((__m128i*)(source7 + 8 * x));
-							
-							c0 = _mm_avg_epu16(c0, c1);
-							c2 = _mm_avg_epu16(c2, c3);
-							c4 = _mm_avg_epu16(c4, c5);
-							c6 = _mm_avg_epu16(c6, c7);
-							c0 = _mm_avg_epu16(c0, c2);
-							c4 = _mm_avg_epu16(c4, c6);
-							c0 = _mm_avg_epu16(c0, c4);
-
-							_mm_store_si128((__m128i*)(source0 + 8 * x), c0);
-						}
+	void Surface::resolve()
+	{
+		if(internal.depth <= 1 || !renderTarget || internal.format == FORMAT_NULL)
+		{
+			return;
+		}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
-				}
-				else if(internal.depth == 16)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 2)
-						{
-							__m128i c0 = _mm_load_si128((__m128i*)(source0 + 8 * x));
-							__m128i c1 = _mm_load_si128((__m128i*)(source1 + 8 * x));
-							__m128i c2 = _mm_load_si128((__m128i*)(source2 + 8 * x));
-							__m128i c3 = _mm_load_si128((__m128i*)(source3 + 8 * x));
-							__m128i c4 = _mm_load_si128((__m128i*)(source4 + 8 * x));
-							__m128i c5 = _mm_load_si128((__m128i*)(source5 + 8 * x));
-							__m128i c6 = _mm_load_si128((__m128i*)(source6 + 8 * x));
-							__m128i c7 = _mm_load_si128((__m128i*)(source7 + 8 * x));
-							__m128i c8 = _mm_load_si128((__m128i*)(source8 + 8 * x));
-							__m128i c9 = _mm_load_si128((__m128i*)(source9 + 8 * x));
-							__m128i cA = _mm_load_si128((__m128i*)(sourceA + 8 * x));
-							__m128i cB = _mm_load_si128((__m128i*)(sourceB + 8 * x));
-							__m128i cC = _mm_load_si128((__m128i*)(sourceC + 8 * x));
-							__m128i cD = _mm_load_si128((__m128i*)(sourceD + 8 * x));
-							__m128i cE = _mm_load_si128((__m128i*)(sourceE + 8 * x));
-							__m128i cF = _mm_load_si128((__m128i*)(sourceF + 8 * x));
-
-							c0 = _mm_avg_epu16(c0, c1);
-							c2 = _mm_avg_epu16(c2, c3);
-							c4 = _mm_avg_epu16(c4, c5);
-							c6 = _mm_avg_epu16(c6, c7);
-							c8 = _mm_avg_epu16(c8, c9);
-							cA = _mm_avg_epu16(cA, cB);
-							cC = _mm_avg_epu16(cC, cD);
-							cE = _mm_avg_epu16(cE, cF);
-							c0 = _mm_avg_epu16(c0, c2);
-							c4 = _mm_avg_epu16(c4, c6);
-							c8 = _mm_avg_epu16(c8, cA);
-							cC = _mm_avg_epu16(cC, cE);
-							c0 = _mm_avg_epu16(c0, c4);
-							c8 = _mm_avg_epu16(c8, cC);
-							c0 = _mm_avg_epu16(c0, c8);
-
-							_mm_store_si128((__m128i*)(source0 + 8 * x), c0);
-						}
+		switch(internal.format)
+		{
+		case FORMAT_X8R8G8B8:
+		case FORMAT_A8R8G8B8:
+		case FORMAT_X8B8G8R8:
+		case FORMAT_A8B8G8R8:
+		case FORMAT_G16R16:
+		case FORMAT_A16B16G16R16:   // Also used for 10-bit formats
+		case FORMAT_R32F:
+		case FORMAT_G32R32F:
+		case FORMAT_A32B32G32R32F:
+			break;
+		default:
+		//	UNIMPLEMENTED();
+			return;
+		}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
-					}
-				}
-				else ASSERT(false);
-			}
-			else
-			{
-				#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7FFF7FFF) + (((x) ^ (y)) & 0x00010001))
+		// The front-ends only create 2, 4, 8 or 16 samples, which the kernels average pairwise
+		if(internal.depth > 16 || (internal.depth & (internal.depth - 1)) != 0)
+		{
+			ASSERT(false);
+			return;
+		}
 
-				if(internal.depth == 2)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < 2 * width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
+		int columns = (internal.width + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
+		int rows = (internal.height + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
 
-							c0 = AVERAGE(c0, c1);
+		// Only the tiles rendered to since the last resolve, unless rendering wasn't tracked per tile
+		int *tiles = new int[columns * rows];
+		int count = 0;
 
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+		for(int i = 0; i < columns * rows; i++)
+		{
+			if(unresolved || (tileState[i] & UNRESOLVED))
+			{
+				tiles[count++] = i;
+			}
 
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < 2 * width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
-							unsigned int c2 = *(unsigned int*)(source2 + 4 * x);
-							unsigned int c3 = *(unsigned int*)(source3 + 4 * x);
+			tileState[i] &= ~UNRESOLVED;
+		}
 
-							c0 = AVERAGE(c0, c1);
-							c2 = AVERAGE(c2, c3);
-							c0 = AVERAGE(c0, c2);
+		unresolved = false;
 
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+		ResolveTask task;
+		task.surface = this;
+		task.buffer = (unsigned char*)internal.lockRect(0, 0, 0, LOCK_READWRITE);
+		task.tiles = tiles;
+		task.count = count;
+		task.next = 0;
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < 2 * width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
-							unsigned int c2 = *(unsigned int*)(source2 + 4 * x);
-							unsigned int c3 = *(unsigned int*)(source3 + 4 * x);
-							unsigned int c4 = *(unsigned int*)(source4 + 4 * x);
-							unsigned int c5 = *(unsigned int*)(source5 + 4 * x);
-							unsigned int c6 = *(unsigned int*)(source6 + 4 * x);
-							unsigned int c7 = *(unsigned int*)(source7 + 4 * x);
-
-							c0 = AVERAGE(c0, c1);
-							c2 = AVERAGE(c2, c3);
-							c4 = AVERAGE(c4, c5);
-							c6 = AVERAGE(c6, c7);
-							c0 = AVERAGE(c0, c2);
-							c4 = AVERAGE(c4, c6);
-							c0 = AVERAGE(c0, c4);
-
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+		// Spread over as many threads as the renderers use, when there's enough work to make up for waking them
+		resolvePool.run(resolveThread, &task, count / 16 - 1);
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
-				}
-				else if(internal.depth == 16)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < 2 * width; x++)
-						{
-							unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
-							unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
-							unsigned int c2 = *(unsigned int*)(source2 + 4 * x);
-							unsigned int c3 = *(unsigned int*)(source3 + 4 * x);
-							unsigned int c4 = *(unsigned int*)(source4 + 4 * x);
-							unsigned int c5 = *(unsigned int*)(source5 + 4 * x);
-							unsigned int c6 = *(unsigned int*)(source6 + 4 * x);
-							unsigned int c7 = *(unsigned int*)(source7 + 4 * x);
-							unsigned int c8 = *(unsigned int*)(source8 + 4 * x);
-							unsigned int c9 = *(unsigned int*)(source9 + 4 * x);
-							unsigned int cA = *(unsigned int*)(sourceA + 4 * x);
-							unsigned int cB = *(unsigned int*)(sourceB + 4 * x);
-							unsigned int cC = *(unsigned int*)(sourceC + 4 * x);
-							unsigned int cD = *(unsigned int*)(sourceD + 4 * x);
-							unsigned int cE = *(unsigned int*)(sourceE + 4 * x);
-							unsigned int cF = *(unsigned int*)(sourceF + 4 * x);
-
-							c0 = AVERAGE(c0, c1);
-							c2 = AVERAGE(c2, c3);
-							c4 = AVERAGE(c4, c5);
-							c6 = AVERAGE(c6, c7);
-							c8 = AVERAGE(c8, c9);
-							cA = AVERAGE(cA, cB);
-							cC = AVERAGE(cC, cD);
-							cE = AVERAGE(cE, cF);
-							c0 = AVERAGE(c0, c2);
-							c4 = AVERAGE(c4, c6);
-							c8 = AVERAGE(c8, cA);
-							cC = AVERAGE(cC, cE);
-							c0 = AVERAGE(c0, c4);
-							c8 = AVERAGE(c8, cC);
-							c0 = AVERAGE(c0, c8);
-
-							*(unsigned int*)(source0 + 4 * x) = c0;
-						}
+		delete[] tiles;
+	}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
-					}
-				}
-				else ASSERT(false);
+	void Surface::resolveThread(void *parameters)
+	{
+		ResolveTask *task = static_cast<ResolveTask*>(parameters);
+		Surface *surface = task->surface;
+		int columns = (surface->internal.width + (1 << TILE_SIZE_LOG2) - 1) >> TILE_SIZE_LOG2;
 
-				#undef AVERAGE
-			}
-		}
-		else if(internal.format == FORMAT_R32F)
+		for(int i = atomicIncrement(&task->next) - 1; i < task->count; i = atomicIncrement(&task->next) - 1)
 		{
-			if(CPUID::supportsSSE() && (width % 4) == 0)
-			{
-				if(internal.depth == 2)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 4 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 4 * x));
-							
-							c0 = _mm_add_ps(c0, c1);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 2.0f)); 
-
-							_mm_store_ps((float*)(source0 + 4 * x), c0);
-						}
-
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 4 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 4 * x));
-							__m128 c2 = _mm_load_ps((float*)(source2 + 4 * x));
-							__m128 c3 = _mm_load_ps((float*)(source3 + 4 * x));
-							
-							c0 = _mm_add_ps(c0, c1);
-							c2 = _mm_add_ps(c2, c3);
-							c0 = _mm_add_ps(c0, c2);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 4.0f)); 
+			int x0 = (task->tiles[i] % columns) << TILE_SIZE_LOG2;
+			int y0 = (task->tiles[i] / columns) << TILE_SIZE_LOG2;
+			int x1 = min(x0 + (1 << TILE_SIZE_LOG2), surface->internal.width);
+			int y1 = min(y0 + (1 << TILE_SIZE_LOG2), surface->internal.height);
 
-							_mm_store_ps((float*)(source0 + 4 * x), c0);
-						}
+			surface->resolve(task->buffer, x0, y0, x1, y1);
+		}
+	}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 4 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 4 * x));
-							__m128 c2 = _mm_load_ps((float*)(source2 + 4 * x));
-							__m128 c3 = _mm_load_ps((float*)(source3 + 4 * x));
-							__m128 c4 = _mm_load_ps((float*)(source4 + 4 * x));
-							__m128 c5 = _mm_load_ps((float*)(source5 + 4 * x));
-							__m128 c6 = _mm_load_ps((float*)(source6 + 4 * x));
-							__m128 c7 = _mm_load_ps((float*)(source7 + 4 * x));
-							
-							c0 = _mm_add_ps(c0, c1);
-							c2 = _mm_add_ps(c2, c3);
-							c4 = _mm_add_ps(c4, c5);
-							c6 = _mm_add_ps(c6, c7);
-							c0 = _mm_add_ps(c0, c2);
-							c4 = _mm_add_ps(c4, c6);
-							c0 = _mm_add_ps(c0, c4);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 8.0f)); 
-
-							_mm_store_ps((float*)(source0 + 4 * x), c0);
-						}
+	void Surface::resolve(unsigned char *buffer, int x0, int y0, int x1, int y1)
+	{
+		int bytes = (x1 - x0) * internal.bytes;
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
-				}
-				else if(internal.depth == 16)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 4)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 4 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 4 * x));
-							__m128 c2 = _mm_load_ps((float*)(source2 + 4 * x));
-							__m128 c3 = _mm_load_ps((float*)(source3 + 4 * x));
-							__m128 c4 = _mm_load_ps((float*)(source4 + 4 * x));
-							__m128 c5 = _mm_load_ps((float*)(source5 + 4 * x));
-							__m128 c6 = _mm_load_ps((float*)(source6 + 4 * x));
-							__m128 c7 = _mm_load_ps((float*)(source7 + 4 * x));
-							__m128 c8 = _mm_load_ps((float*)(source8 + 4 * x));
-							__m128 c9 = _mm_load_ps((float*)(source9 + 4 * x));
-							__m128 cA = _mm_load_ps((float*)(sourceA + 4 * x));
-							__m128 cB = _mm_load_ps((float*)(sourceB + 4 * x));
-							__m128 cC = _mm_load_ps((float*)(sourceC + 4 * x));
-							__m128 cD = _mm_load_ps((float*)(sourceD + 4 * x));
-							__m128 cE = _mm_load_ps((float*)(sourceE + 4 * x));
-							__m128 cF = _mm_load_ps((float*)(sourceF + 4 * x));
-
-							c0 = _mm_add_ps(c0, c1);
-							c2 = _mm_add_ps(c2, c3);
-							c4 = _mm_add_ps(c4, c5);
-							c6 = _mm_add_ps(c6, c7);
-							c8 = _mm_add_ps(c8, c9);
-							cA = _mm_add_ps(cA, cB);
-							cC = _mm_add_ps(cC, cD);
-							cE = _mm_add_ps(cE, cF);
-							c0 = _mm_add_ps(c0, c2);
-							c4 = _mm_add_ps(c4, c6);
-							c8 = _mm_add_ps(c8, cA);
-							cC = _mm_add_ps(cC, cE);
-							c0 = _mm_add_ps(c0, c4);
-							c8 = _mm_add_ps(c8, cC);
-							c0 = _mm_add_ps(c0, c8);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 16.0f)); 
-
-							_mm_store_ps((float*)(source0 + 4 * x), c0);
-						}
+		for(int y = y0; y < y1; y++)
+		{
+			unsigned char *row = buffer + y * internal.pitchB + x0 * internal.bytes;
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
-					}
-				}
-				else ASSERT(false);
-			}
-			else
+			switch(internal.format)
 			{
-				if(internal.depth == 2)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
+			case FORMAT_X8R8G8B8:
+			case FORMAT_A8R8G8B8:
+			case FORMAT_X8B8G8R8:
+			case FORMAT_A8B8G8R8:
+				average8(row, bytes, internal.sliceB, internal.depth);
+				break;
+			case FORMAT_G16R16:
+			case FORMAT_A16B16G16R16:
+				average16(row, bytes, internal.sliceB, internal.depth);
+				break;
+			case FORMAT_R32F:
+			case FORMAT_G32R32F:
+			case FORMAT_A32B32G32R32F:
+				average32F(row, bytes, internal.sliceB, internal.depth);
+				break;
+			default:
+				ASSERT(false);
+			}
+		}
+	}
 
-							c0 = c0 + c1;
-							c0 *= 1.0f / 2.0f;
+	// The samples are averaged pairwise, rounding up, which makes the vector and scalar paths match.
+	// Their count has to be a power of two, up to 16.
+	void Surface::average8(unsigned char *row, int bytes, int slice, int samples)
+	{
+		int x = 0;
 
-							*(float*)(source0 + 4 * x) = c0;
-						}
+		if(CPUID::supportsSSE2())
+		{
+			for(; x + 16 <= bytes; x += 16)
+			{
+				__m128i c[16];
 
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
+				for(int s = 0; s < samples; s++)
 				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-							float c2 = *(float*)(source2 + 4 * x);
-							float c3 = *(float*)(source3 + 4 * x);
-
-							c0 = c0 + c1;
-							c2 = c2 + c3;
-							c0 = c0 + c2;
-							c0 *= 1.0f / 4.0f;
-
-							*(float*)(source0 + 4 * x) = c0;
-						}
-
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
+					c[s] = _mm_loadu_si128((__m128i*)(row + s * slice + x));
 				}
-				else if(internal.depth == 8)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-							float c2 = *(float*)(source2 + 4 * x);
-							float c3 = *(float*)(source3 + 4 * x);
-							float c4 = *(float*)(source4 + 4 * x);
-							float c5 = *(float*)(source5 + 4 * x);
-							float c6 = *(float*)(source6 + 4 * x);
-							float c7 = *(float*)(source7 + 4 * x);
-
-							c0 = c0 + c1;
-							c2 = c2 + c3;
-							c4 = c4 + c5;
-							c6 = c6 + c7;
-							c0 = c0 + c2;
-							c4 = c4 + c6;
-							c0 = c0 + c4;
-							c0 *= 1.0f / 8.0f;
-
-							*(float*)(source0 + 4 * x) = c0;
-						}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
-				}
-				else if(internal.depth == 16)
+				for(int step = 1; step < samples; step *= 2)
 				{
-					for(int y = 0; y < height; y++)
+					for(int s = 0; s < samples; s += 2 * step)
 					{
-						for(int x = 0; x < width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-							float c2 = *(float*)(source2 + 4 * x);
-							float c3 = *(float*)(source3 + 4 * x);
-							float c4 = *(float*)(source4 + 4 * x);
-							float c5 = *(float*)(source5 + 4 * x);
-							float c6 = *(float*)(source6 + 4 * x);
-							float c7 = *(float*)(source7 + 4 * x);
-							float c8 = *(float*)(source8 + 4 * x);
-							float c9 = *(float*)(source9 + 4 * x);
-							float cA = *(float*)(sourceA + 4 * x);
-							float cB = *(float*)(sourceB + 4 * x);
-							float cC = *(float*)(sourceC + 4 * x);
-							float cD = *(float*)(sourceD + 4 * x);
-							float cE = *(float*)(sourceE + 4 * x);
-							float cF = *(float*)(sourceF + 4 * x);
-
-							c0 = c0 + c1;
-							c2 = c2 + c3;
-							c4 = c4 + c5;
-							c6 = c6 + c7;
-							c8 = c8 + c9;
-							cA = cA + cB;
-							cC = cC + cD;
-							cE = cE + cF;
-							c0 = c0 + c2;
-							c4 = c4 + c6;
-							c8 = c8 + cA;
-							cC = cC + cE;
-							c0 = c0 + c4;
-							c8 = c8 + cC;
-							c0 = c0 + c8;
-							c0 *= 1.0f / 16.0f;
-
-							*(float*)(source0 + 4 * x) = c0;
-						}
-
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
+						c[s] = _mm_avg_epu8(c[s], c[s + step]);
 					}
 				}
-				else ASSERT(false);
+
+				_mm_storeu_si128((__m128i*)(row + x), c[0]);
 			}
 		}
-		else if(internal.format == FORMAT_G32R32F)
-		{
-			if(CPUID::supportsSSE() && (width % 2) == 0)
-			{
-				if(internal.depth == 2)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 2)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 8 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 8 * x));
-							
-							c0 = _mm_add_ps(c0, c1);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 2.0f)); 
 
-							_mm_store_ps((float*)(source0 + 8 * x), c0);
-						}
+		#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7F7F7F7F) + (((x) ^ (y)) & 0x01010101))
 
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 2)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 8 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 8 * x));
-							__m128 c2 = _mm_load_ps((float*)(source2 + 8 * x));
-							__m128 c3 = _mm_load_ps((float*)(source3 + 8 * x));
-							
-							c0 = _mm_add_ps(c0, c1);
-							c2 = _mm_add_ps(c2, c3);
-							c0 = _mm_add_ps(c0, c2);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 4.0f)); 
-
-							_mm_store_ps((float*)(source0 + 8 * x), c0);
-						}
+		for(; x < bytes; x += 4)
+		{
+			unsigned int c[16];
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 2)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 8 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 8 * x));
-							__m128 c2 = _mm_load_ps((float*)(source2 + 8 * x));
-							__m128 c3 = _mm_load_ps((float*)(source3 + 8 * x));
-							__m128 c4 = _mm_load_ps((float*)(source4 + 8 * x));
-							__m128 c5 = _mm_load_ps((float*)(source5 + 8 * x));
-							__m128 c6 = _mm_load_ps((float*)(source6 + 8 * x));
-							__m128 c7 = _mm_load_ps((float*)(source7 + 8 * x));
-							
-							c0 = _mm_add_ps(c0, c1);
-							c2 = _mm_add_ps(c2, c3);
-							c4 = _mm_add_ps(c4, c5);
-							c6 = _mm_add_ps(c6, c7);
-							c0 = _mm_add_ps(c0, c2);
-							c4 = _mm_add_ps(c4, c6);
-							c0 = _mm_add_ps(c0, c4);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 8.0f)); 
-
-							_mm_store_ps((float*)(source0 + 8 * x), c0);
-						}
+			for(int s = 0; s < samples; s++)
+			{
+				c[s] = *(unsigned int*)(row + s * slice + x);
+			}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
-				}
-				else if(internal.depth == 16)
+			for(int step = 1; step < samples; step *= 2)
+			{
+				for(int s = 0; s < samples; s += 2 * step)
 				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x += 2)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 8 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 8 * x));
-							__m128 c2 = _mm_load_ps((float*)(source2 + 8 * x));
-							__m128 c3 = _mm_load_ps((float*)(source3 + 8 * x));
-							__m128 c4 = _mm_load_ps((float*)(source4 + 8 * x));
-							__m128 c5 = _mm_load_ps((float*)(source5 + 8 * x));
-							__m128 c6 = _mm_load_ps((float*)(source6 + 8 * x));
-							__m128 c7 = _mm_load_ps((float*)(source7 + 8 * x));
-							__m128 c8 = _mm_load_ps((float*)(source8 + 8 * x));
-							__m128 c9 = _mm_load_ps((float*)(source9 + 8 * x));
-							__m128 cA = _mm_load_ps((float*)(sourceA + 8 * x));
-							__m128 cB = _mm_load_ps((float*)(sourceB + 8 * x));
-							__m128 cC = _mm_load_ps((float*)(sourceC + 8 * x));
-							__m128 cD = _mm_load_ps((float*)(sourceD + 8 * x));
-							__m128 cE = _mm_load_ps((float*)(sourceE + 8 * x));
-							__m128 cF = _mm_load_ps((float*)(sourceF + 8 * x));
-
-							c0 = _mm_add_ps(c0, c1);
-							c2 = _mm_add_ps(c2, c3);
-							c4 = _mm_add_ps(c4, c5);
-							c6 = _mm_add_ps(c6, c7);
-							c8 = _mm_add_ps(c8, c9);
-							cA = _mm_add_ps(cA, cB);
-							cC = _mm_add_ps(cC, cD);
-							cE = _mm_add_ps(cE, cF);
-							c0 = _mm_add_ps(c0, c2);
-							c4 = _mm_add_ps(c4, c6);
-							c8 = _mm_add_ps(c8, cA);
-							cC = _mm_add_ps(cC, cE);
-							c0 = _mm_add_ps(c0, c4);
-							c8 = _mm_add_ps(c8, cC);
-							c0 = _mm_add_ps(c0, c8);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 16.0f)); 
-
-							_mm_store_ps((float*)(source0 + 8 * x), c0);
-						}
-
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
-					}
+					c[s] = AVERAGE(c[s], c[s + step]);
 				}
-				else ASSERT(false);
 			}
-			else
-			{
-				if(internal.depth == 2)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < 2 * width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-
-							c0 = c0 + c1;
-							c0 *= 1.0f / 2.0f;
 
-							*(float*)(source0 + 4 * x) = c0;
-						}
+			*(unsigned int*)(row + x) = c[0];
+		}
 
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < 2 * width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-							float c2 = *(float*)(source2 + 4 * x);
-							float c3 = *(float*)(source3 + 4 * x);
+		#undef AVERAGE
+	}
 
-							c0 = c0 + c1;
-							c2 = c2 + c3;
-							c0 = c0 + c2;
-							c0 *= 1.0f / 4.0f;
+	void Surface::average16(unsigned char *row, int bytes, int slice, int samples)
+	{
+		int x = 0;
 
-							*(float*)(source0 + 4 * x) = c0;
-						}
+		if(CPUID::supportsSSE2())
+		{
+			for(; x + 16 <= bytes; x += 16)
+			{
+				__m128i c[16];
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
+				for(int s = 0; s < samples; s++)
 				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < 2 * width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-							float c2 = *(float*)(source2 + 4 * x);
-							float c3 = *(float*)(source3 + 4 * x);
-							float c4 = *(float*)(source4 + 4 * x);
-							float c5 = *(float*)(source5 + 4 * x);
-							float c6 = *(float*)(source6 + 4 * x);
-							float c7 = *(float*)(source7 + 4 * x);
-
-							c0 = c0 + c1;
-							c2 = c2 + c3;
-							c4 = c4 + c5;
-							c6 = c6 + c7;
-							c0 = c0 + c2;
-							c4 = c4 + c6;
-							c0 = c0 + c4;
-							c0 *= 1.0f / 8.0f;
-
-							*(float*)(source0 + 4 * x) = c0;
-						}
-
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
+					c[s] = _mm_loadu_si128((__m128i*)(row + s * slice + x));
 				}
-				else if(internal.depth == 16)
+
+				for(int step = 1; step < samples; step *= 2)
 				{
-					for(int y = 0; y < height; y++)
+					for(int s = 0; s < samples; s += 2 * step)
 					{
-						for(int x = 0; x < 2 * width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-							float c2 = *(float*)(source2 + 4 * x);
-							float c3 = *(float*)(source3 + 4 * x);
-							float c4 = *(float*)(source4 + 4 * x);
-							float c5 = *(float*)(source5 + 4 * x);
-							float c6 = *(float*)(source6 + 4 * x);
-							float c7 = *(float*)(source7 + 4 * x);
-							float c8 = *(float*)(source8 + 4 * x);
-							float c9 = *(float*)(source9 + 4 * x);
-							float cA = *(float*)(sourceA + 4 * x);
-							float cB = *(float*)(sourceB + 4 * x);
-							float cC = *(float*)(sourceC + 4 * x);
-							float cD = *(float*)(sourceD + 4 * x);
-							float cE = *(float*)(sourceE + 4 * x);
-							float cF = *(float*)(sourceF + 4 * x);
-
-							c0 = c0 + c1;
-							c2 = c2 + c3;
-							c4 = c4 + c5;
-							c6 = c6 + c7;
-							c8 = c8 + c9;
-							cA = cA + cB;
-							cC = cC + cD;
-							cE = cE + cF;
-							c0 = c0 + c2;
-							c4 = c4 + c6;
-							c8 = c8 + cA;
-							cC = cC + cE;
-							c0 = c0 + c4;
-							c8 = c8 + cC;
-							c0 = c0 + c8;
-							c0 *= 1.0f / 16.0f;
-
-							*(float*)(source0 + 4 * x) = c0;
-						}
-
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
+						c[s] = _mm_avg_epu16(c[s], c[s + step]);
 					}
 				}
-				else ASSERT(false);
+
+				_mm_storeu_si128((__m128i*)(row + x), c[0]);
 			}
 		}
-		else if(internal.format == FORMAT_A32B32G32R32F)
+
+		for(; x < bytes; x += 2)
 		{
-			if(CPUID::supportsSSE())
+			unsigned int c[16];
+
+			for(int s = 0; s < samples; s++)
+			{
+				c[s] = *(unsigned short*)(row + s * slice + x);
+			}
+
+			for(int step = 1; step < samples; step *= 2)
 			{
-				if(internal.depth == 2)
+				for(int s = 0; s < samples; s += 2 * step)
 				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 16 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 16 * x));
-							
-							c0 = _mm_add_ps(c0, c1);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 2.0f)); 
+					c[s] = (c[s] + c[s + step] + 1) >> 1;
+				}
+			}
 
-							_mm_store_ps((float*)(source0 + 16 * x), c0);
-						}
+			*(unsigned short*)(row + x) = c[0];
+		}
+	}
 
-						source0 += pitch;
-						source1 += pitch;
-					}
-				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 16 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 16 * x));
-							__m128 c2 = _mm_load_ps((float*)(source2 + 16 * x));
-							__m128 c3 = _mm_load_ps((float*)(source3 + 16 * x));
-							
-							c0 = _mm_add_ps(c0, c1);
-							c2 = _mm_add_ps(c2, c3);
-							c0 = _mm_add_ps(c0, c2);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 4.0f)); 
+	void Surface::average32F(unsigned char *row, int bytes, int slice, int samples)
+	{
+		int x = 0;
 
-							_mm_store_ps((float*)(source0 + 16 * x), c0);
-						}
+		if(CPUID::supportsSSE())
+		{
+			for(; x + 16 <= bytes; x += 16)
+			{
+				__m128 c[16];
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
+				for(int s = 0; s < samples; s++)
 				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 16 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 16 * x));
-							__m128 c2 = _mm_load_ps((float*)(source2 + 16 * x));
-							__m128 c3 = _mm_load_ps((float*)(source3 + 16 * x));
-							__m128 c4 = _mm_load_ps((float*)(source4 + 16 * x));
-							__m128 c5 = _mm_load_ps((float*)(source5 + 16 * x));
-							__m128 c6 = _mm_load_ps((float*)(source6 + 16 * x));
-							__m128 c7 = _mm_load_ps((float*)(source7 + 16 * x));
-							
-							c0 = _mm_add_ps(c0, c1);
-							c2 = _mm_add_ps(c2, c3);
-							c4 = _mm_add_ps(c4, c5);
-							c6 = _mm_add_ps(c6, c7);
-							c0 = _mm_add_ps(c0, c2);
-							c4 = _mm_add_ps(c4, c6);
-							c0 = _mm_add_ps(c0, c4);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 8.0f)); 
-
-							_mm_store_ps((float*)(source0 + 16 * x), c0);
-						}
-
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
+					c[s] = _mm_loadu_ps((float*)(row + s * slice + x));
 				}
-				else if(internal.depth == 16)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < width; x++)
-						{
-							__m128 c0 = _mm_load_ps((float*)(source0 + 16 * x));
-							__m128 c1 = _mm_load_ps((float*)(source1 + 16 * x));
-							__m128 c2 = _mm_load_ps((float*)(source2 + 16 * x));
-							__m128 c3 = _mm_load_ps((float*)(source3 + 16 * x));
-							__m128 c4 = _mm_load_ps((float*)(source4 + 16 * x));
-							__m128 c5 = _mm_load_ps((float*)(source5 + 16 * x));
-							__m128 c6 = _mm_load_ps((float*)(source6 + 16 * x));
-							__m128 c7 = _mm_load_ps((float*)(source7 + 16 * x));
-							__m128 c8 = _mm_load_ps((float*)(source8 + 16 * x));
-							__m128 c9 = _mm_load_ps((float*)(source9 + 16 * x));
-							__m128 cA = _mm_load_ps((float*)(sourceA + 16 * x));
-							__m128 cB = _mm_load_ps((float*)(sourceB + 16 * x));
-							__m128 cC = _mm_load_ps((float*)(sourceC + 16 * x));
-							__m128 cD = _mm_load_ps((float*)(sourceD + 16 * x));
-							__m128 cE = _mm_load_ps((float*)(sourceE + 16 * x));
-							__m128 cF = _mm_load_ps((float*)(sourceF + 16 * x));
-
-							c0 = _mm_add_ps(c0, c1);
-							c2 = _mm_add_ps(c2, c3);
-							c4 = _mm_add_ps(c4, c5);
-							c6 = _mm_add_ps(c6, c7);
-							c8 = _mm_add_ps(c8, c9);
-							cA = _mm_add_ps(cA, cB);
-							cC = _mm_add_ps(cC, cD);
-							cE = _mm_add_ps(cE, cF);
-							c0 = _mm_add_ps(c0, c2);
-							c4 = _mm_add_ps(c4, c6);
-							c8 = _mm_add_ps(c8, cA);
-							cC = _mm_add_ps(cC, cE);
-							c0 = _mm_add_ps(c0, c4);
-							c8 = _mm_add_ps(c8, cC);
-							c0 = _mm_add_ps(c0, c8);
-							c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 16.0f)); 
-
-							_mm_store_ps((float*)(source0 + 16 * x), c0);
-						}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
-					}
-				}
-				else ASSERT(false);
-			}
-			else
-			{
-				if(internal.depth == 2)
+				for(int step = 1; step < samples; step *= 2)
 				{
-					for(int y = 0; y < height; y++)
+					for(int s = 0; s < samples; s += 2 * step)
 					{
-						for(int x = 0; x < 4 * width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-
-							c0 = c0 + c1;
-							c0 *= 1.0f / 2.0f;
-
-							*(float*)(source0 + 4 * x) = c0;
-						}
-
-						source0 += pitch;
-						source1 += pitch;
+						c[s] = _mm_add_ps(c[s], c[s + step]);
 					}
 				}
-				else if(internal.depth == 4)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < 4 * width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-							float c2 = *(float*)(source2 + 4 * x);
-							float c3 = *(float*)(source3 + 4 * x);
 
-							c0 = c0 + c1;
-							c2 = c2 + c3;
-							c0 = c0 + c2;
-							c0 *= 1.0f / 4.0f;
+				_mm_storeu_ps((float*)(row + x), _mm_mul_ps(c[0], _mm_set1_ps(1.0f / samples)));
+			}
+		}
 
-							*(float*)(source0 + 4 * x) = c0;
-						}
+		for(; x < bytes; x += 4)
+		{
+			float c[16];
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-					}
-				}
-				else if(internal.depth == 8)
-				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < 4 * width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-							float c2 = *(float*)(source2 + 4 * x);
-							float c3 = *(float*)(source3 + 4 * x);
-							float c4 = *(float*)(source4 + 4 * x);
-							float c5 = *(float*)(source5 + 4 * x);
-							float c6 = *(float*)(source6 + 4 * x);
-							float c7 = *(float*)(source7 + 4 * x);
-
-							c0 = c0 + c1;
-							c2 = c2 + c3;
-							c4 = c4 + c5;
-							c6 = c6 + c7;
-							c0 = c0 + c2;
-							c4 = c4 + c6;
-							c0 = c0 + c4;
-							c0 *= 1.0f / 8.0f;
-
-							*(float*)(source0 + 4 * x) = c0;
-						}
+			for(int s = 0; s < samples; s++)
+			{
+				c[s] = *(float*)(row + s * slice + x);
+			}
 
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-					}
-				}
-				else if(internal.depth == 16)
+			for(int step = 1; step < samples; step *= 2)
+			{
+				for(int s = 0; s < samples; s += 2 * step)
 				{
-					for(int y = 0; y < height; y++)
-					{
-						for(int x = 0; x < 4 * width; x++)
-						{
-							float c0 = *(float*)(source0 + 4 * x);
-							float c1 = *(float*)(source1 + 4 * x);
-							float c2 = *(float*)(source2 + 4 * x);
-							float c3 = *(float*)(source3 + 4 * x);
-							float c4 = *(float*)(source4 + 4 * x);
-							float c5 = *(float*)(source5 + 4 * x);
-							float c6 = *(float*)(source6 + 4 * x);
-							float c7 = *(float*)(source7 + 4 * x);
-							float c8 = *(float*)(source8 + 4 * x);
-							float c9 = *(float*)(source9 + 4 * x);
-							float cA = *(float*)(sourceA + 4 * x);
-							float cB = *(float*)(sourceB + 4 * x);
-							float cC = *(float*)(sourceC + 4 * x);
-							float cD = *(float*)(sourceD + 4 * x);
-							float cE = *(float*)(sourceE + 4 * x);
-							float cF = *(float*)(sourceF + 4 * x);
-
-							c0 = c0 + c1;
-							c2 = c2 + c3;
-							c4 = c4 + c5;
-							c6 = c6 + c7;
-							c8 = c8 + c9;
-							cA = cA + cB;
-							cC = cC + cD;
-							cE = cE + cF;
-							c0 = c0 + c2;
-							c4 = c4 + c6;
-							c8 = c8 + cA;
-							cC = cC + cE;
-							c0 = c0 + c4;
-							c8 = c8 + cC;
-							c0 = c0 + c8;
-							c0 *= 1.0f / 16.0f;
-
-							*(float*)(source0 + 4 * x) = c0;
-						}
-
-						source0 += pitch;
-						source1 += pitch;
-						source2 += pitch;
-						source3 += pitch;
-						source4 += pitch;
-						source5 += pitch;
-						source6 += pitch;
-						source7 += pitch;
-						source8 += pitch;
-						source9 += pitch;
-						sourceA += pitch;
-						sourceB += pitch;
-						sourceC += pitch;
-						sourceD += pitch;
-						sourceE += pitch;
-						sourceF += pitch;
-					}
+					c[s] = c[s] + c[s + step];
 				}
-				else ASSERT(false);
 			}
-		}
-		else
-		{
-		//	UNIMPLEMENTED();
+
+			*(float*)(row + x) = c[0] * (1.0f / samples);
 		}
 	}
 }
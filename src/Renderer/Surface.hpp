@@ -210,6 +210,15 @@ namespace sw
 		inline int getStencilPitchP() const;
 		inline int getStencilSliceB() const;
 
+		float *getHiZ();   // Upper bound of the first sample's depth, per block
+		inline int getHiZPitchB() const;
+		void invalidateHiZ();
+		void discardHiZ();   // Waits for the renderer to stop using it
+
+		inline bool tracksTiles() const;        // Rendering has to touch the tiles first
+		void touchTile(int tileX, int tileY);   // By the cluster rendering to the tile
+		void touchTiles();                      // Before rendering which isn't binned to tiles
+
 		inline int getMultiSampleCount() const;
 		inline int getSuperSampleCount() const;
 
@@ -262,6 +271,9 @@ namespace sw
 
 		static void setTexturePalette(unsigned int *palette);
 
+		static void startResolveThreads(int threadCount);   // By each renderer starting its threads
+		static void stopResolveThreads();                   // The last one ends the resolve threads
+
 	protected:
 		sw::Resource *resource;
 
@@ -373,10 +385,47 @@ namespace sw
 
 		void resolve();
 
+		enum TileState
+		{
+			CLEAR_INTERNAL = 0x1,   // Still to be filled with the deferred clear
+			CLEAR_STENCIL = 0x2,
+			UNRESOLVED = 0x4        // Rendered to since the last resolve
+		};
+
+		bool deferClear(TileState buffer, unsigned int value);
+		void fillClearedTiles();
+		void fillTile(int buffers, int tileX, int tileY);
+		static void fillTile(Buffer &buffer, unsigned int value, bool quadLayout, int tileX, int tileY);
+
+		struct ResolveTask
+		{
+			Surface *surface;
+			unsigned char *buffer;
+			const int *tiles;
+			int count;
+			volatile int next;
+		};
+
+		static void resolveThread(void *parameters);
+		void resolve(unsigned char *buffer, int x0, int y0, int x1, int y1);
+		static void average8(unsigned char *row, int bytes, int slice, int samples);
+		static void average16(unsigned char *row, int bytes, int slice, int samples);
+		static void average32F(unsigned char *row, int bytes, int slice, int samples);
+
 		Buffer external;
 		Buffer internal;
 		Buffer stencil;
 
+		float *hiZ;   // Allocated when first rendered to with hierarchical depth
+
+		// Entire clears only mark the tiles, which get filled when first rendered to or locked.
+		// Multisampled targets also keep track of the tiles which have to be resolved.
+		unsigned char *tileState;
+		unsigned int internalClear;
+		unsigned int stencilClear;
+		bool clearDeferred;
+		bool unresolved;   // All tiles have to be resolved
+
 		const bool lockable;
 		const bool renderTarget;
 
@@ -511,6 +560,16 @@ namespace sw
 		return stencil.sliceB;
 	}
 
+	int Surface::getHiZPitchB() const
+	{
+		return ((internal.width + (1 << BLOCK_SIZE_LOG2) - 1) >> BLOCK_SIZE_LOG2) * sizeof(float);
+	}
+
+	bool Surface::tracksTiles() const
+	{
+		return clearDeferred || (renderTarget && internal.depth > 1);
+	}
+
 	int Surface::getMultiSampleCount() const
 	{
 		return sw::min(internal.depth, 4);
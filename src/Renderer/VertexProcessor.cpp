@@ -23,8 +23,50 @@
 
 namespace sw
 {
+	extern bool backgroundCompilation;
+	extern int recompileThreshold;
+
 	bool precacheVertex = false;
 
+	class VertexRoutineTask : public RoutineCompiler::Task
+	{
+	public:
+		VertexRoutineTask(const VertexProcessor::State &state, const VertexShader *shader) : state(state), shader(shader && !state.fixedFunction ? new VertexShader(shader) : 0)
+		{
+		}
+
+		virtual ~VertexRoutineTask()
+		{
+			delete shader;
+		}
+
+		const VertexProcessor::State state;
+
+	protected:
+		virtual Routine *compile()
+		{
+			VertexRoutine *generator = 0;
+
+			if(state.fixedFunction)
+			{
+				generator = new VertexPipeline(state);
+			}
+			else
+			{
+				generator = new VertexProgram(state, shader);
+			}
+
+			generator->generate(true);
+			Routine *routine = generator->getRoutine();
+			delete generator;
+
+			return routine;
+		}
+
+	private:
+		VertexShader *const shader;   // Private copy, the application may delete the original
+	};
+
 	void VertexCache::clear()
 	{
 		for(int i = 0; i < 16; i++)
@@ -36,11 +78,11 @@ namespace sw
 	unsigned int VertexProcessor::States::computeHash()
 	{
 		unsigned int *state = (unsigned int*)this;
-		unsigned int hash = 0;
+		unsigned int hash = 2166136261;   // FNV-1a on 32-bit words, well distributed for indexing the routine cache
 
 		for(int i = 0; i < sizeof(States) / 4; i++)
 		{
-			hash ^= state[i];
+			hash = (hash ^ state[i]) * 16777619;
 		}
 
 		return hash;
@@ -99,13 +141,17 @@ namespace sw
 			updateModelMatrix[i] = true;
 		}
 
+		routineCompiler = 0;
 		routineCache = 0;
 		setRoutineCacheSize(1024);
 	}
 
 	VertexProcessor::~VertexProcessor()
 	{
-		delete routineCache;
+		delete routineCompiler;
+		routineCompiler = 0;
+
+		RoutineCache<State>::release(routineCache);
 		routineCache = 0;
 	}
 
@@ -732,8 +778,16 @@ namespace sw
 
 	void VertexProcessor::setRoutineCacheSize(int cacheSize)
 	{
-		delete routineCache;
-		routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), precacheVertex ? "sw-vertex" : 0);
+		if(routineCompiler)
+		{
+			routineCompiler->discard();
+		}
+
+		RoutineCache<State>::release(routineCache);
+
+		int size = clamp(cacheSize, 1, 65536);
+		const char *precache = precacheVertex ? "sw-vertex" : 0;
+		routineCache = sharedRoutineCache ? RoutineCache<State>::share(size, precache, "sw-vertex") : new RoutineCache<State>(size, precache, "sw-vertex");
 	}
 
 	const VertexProcessor::State VertexProcessor::update()
@@ -761,11 +815,15 @@ namespace sw
 
 		if(context->vertexShader)
 		{
-			state.shaderID = context->vertexShader->getSerialID();
+			const uint64_t *shaderID = context->vertexShader->getID();
+
+			state.shaderID[0] = shaderID[0];
+			state.shaderID[1] = shaderID[1];
 		}
 		else
 		{
-			state.shaderID = 0;
+			state.shaderID[0] = 0;
+			state.shaderID[1] = 0;
 		}
 
 		state.fixedFunction = !context->vertexShader && context->pixelShaderVersion() < 0x0300;
@@ -830,6 +888,7 @@ namespace sw
 				if(context->vertexShader->usesSampler(i))
 				{
 					state.samplerState[i] = context->sampler[TEXTURE_IMAGE_UNITS + i].samplerState();
+					state.samplerMethods[i] = context->vertexShader->getSamplerMethods();
 				}
 			}
 		}
@@ -916,7 +975,16 @@ namespace sw
 
 	Routine *VertexProcessor::routine(const State &state)
 	{
-		Routine *routine = routineCache->query(state);
+		if(routineCompiler)
+		{
+			while(RoutineCompiler::Task *task = routineCompiler->retrieve())
+			{
+				routineCache->replace(static_cast<VertexRoutineTask*>(task)->state, task->getRoutine());
+				delete task;
+			}
+		}
+
+		Routine *routine = routineCache->acquire(state);
 
 		if(!routine)   // Create one
 		{
@@ -931,11 +999,21 @@ namespace sw
 				generator = new VertexProgram(state, context->vertexShader);
 			}
 
-			generator->generate();
+			generator->generate(!backgroundCompilation);
 			routine = generator->getRoutine();
 			delete generator;
 
-			routineCache->add(state, routine);
+			routine = routineCache->acquire(state, routine);
+		}
+
+		if(!routine->isOptimized() && routine->use() == recompileThreshold)
+		{
+			if(!routineCompiler)
+			{
+				routineCompiler = new RoutineCompiler();
+			}
+
+			routineCompiler->queue(new VertexRoutineTask(state, context->vertexShader));
 		}
 
 		return routine;
@@ -15,6 +15,7 @@
 #include "Matrix.hpp"
 #include "Context.hpp"
 #include "RoutineCache.hpp"
+#include "RoutineCompiler.hpp"
 
 namespace sw
 {
@@ -43,7 +44,7 @@ namespace sw
 		{
 			unsigned int computeHash();
 
-			uint64_t shaderID;
+			uint64_t shaderID[2];   // Zero without a shader
 
 			bool fixedFunction             : 1;
 			bool shaderContainsTexldl      : 1;
@@ -83,8 +84,6 @@ namespace sw
 
 			TextureState textureState[8];
 
-			Sampler::State samplerState[VERTEX_TEXTURE_IMAGE_UNITS];
-
 			struct Input
 			{
 				operator bool() const   // Returns true if stream contains data
@@ -137,6 +136,10 @@ namespace sw
 			bool operator==(const State &state) const;
 
 			unsigned int hash;
+
+			// Not part of the routine key, sampling is done by calling the routines in the draw data
+			Sampler::State samplerState[VERTEX_TEXTURE_IMAGE_UNITS];
+			unsigned char samplerMethods[VERTEX_TEXTURE_IMAGE_UNITS];   // Bit flags, by SamplerMethod
 		};
 
 		struct FixedFunction
@@ -256,7 +259,7 @@ namespace sw
 		const Matrix &getViewTransform();
 
 		const State update();
-		Routine *routine(const State &state);
+		Routine *routine(const State &state);   // Bound, for the draw call to unbind
 
 		bool isFixedFunction();
 		void setRoutineCacheSize(int cacheSize);
@@ -279,6 +282,7 @@ namespace sw
 		Context *const context;
 
 		RoutineCache<State> *routineCache;
+		RoutineCompiler *routineCompiler;
 
 	protected:
 		Matrix M[12];      // Model/Geometry/World matrix
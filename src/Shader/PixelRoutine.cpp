@@ -49,21 +49,15 @@ namespace sw
 
 	PixelRoutine::~PixelRoutine()
 	{
-		for(int i = 0; i < TEXTURE_IMAGE_UNITS; i++)
-		{
-			delete sampler[i];
-		}
 	}
 
 	void PixelRoutine::quad(Registers &r, Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int cMask[4], Int &x, Int &y)
 	{
-		#if PERF_PROFILE
-			Long pipeTime = Ticks();
-		#endif
+		Long pipeTime;
 
-		for(int i = 0; i < TEXTURE_IMAGE_UNITS; i++)
+		if(state.profile)
 		{
-			sampler[i] = new SamplerCore(r.constants, state.sampler[i]);
+			pipeTime = Ticks();
 		}
 
 		const bool earlyDepthTest = !state.depthOverride && !state.alphaTestActive();
@@ -119,9 +113,12 @@ namespace sw
 
 		If(depthPass || Bool(!earlyDepthTest))
 		{
-			#if PERF_PROFILE
-				Long interpTime = Ticks();
-			#endif
+			Long interpTime;
+
+			if(state.profile)
+			{
+				interpTime = Ticks();
+			}
 
 			Float4 yyyy = Float4(Float(y)) + *Pointer<Float4>(r.primitive + OFFSET(Primitive,yQuad), 16);
 
@@ -251,17 +248,21 @@ namespace sw
 				}
 			}
 
-			#if PERF_PROFILE
+			if(state.profile)
+			{
 				r.cycles[PERF_INTERP] += Ticks() - interpTime;
-			#endif
+			}
 
 			Bool alphaPass = true;
 
 			if(colorUsed())
 			{
-				#if PERF_PROFILE
-					Long shaderTime = Ticks();
-				#endif
+				Long shaderTime;
+
+				if(state.profile)
+				{
+					shaderTime = Ticks();
+				}
 
 				if(shader)
 				{
@@ -301,9 +302,10 @@ namespace sw
 					specularPixel(r.current, r.specular);
 				}
 
-				#if PERF_PROFILE
+				if(state.profile)
+				{
 					r.cycles[PERF_SHADER] += Ticks() - shaderTime;
-				#endif
+				}
 
 				if(integerPipeline)
 				{
@@ -341,9 +343,12 @@ namespace sw
 					}
 				}
 
-				#if PERF_PROFILE
-					Long ropTime = Ticks();
-				#endif
+				Long ropTime;
+
+				if(state.profile)
+				{
+					ropTime = Ticks();
+				}
 
 				If(depthPass || Bool(earlyDepthTest))
 				{
@@ -362,9 +367,10 @@ namespace sw
 
 					if(colorUsed())
 					{
-						#if PERF_PROFILE
+						if(state.profile)
+						{
 							AddAtomic(Pointer<Long>(&profiler.ropOperations), 4);
-						#endif
+						}
 
 						if(integerPipeline)
 						{
@@ -377,9 +383,10 @@ namespace sw
 					}
 				}
 
-				#if PERF_PROFILE
+				if(state.profile)
+				{
 					r.cycles[PERF_ROP] += Ticks() - ropTime;
-				#endif
+				}
 			}
 		}
 
@@ -391,9 +398,10 @@ namespace sw
 			}
 		}
 
-		#if PERF_PROFILE
+		if(state.profile)
+		{
 			r.cycles[PERF_PIPE] += Ticks() - pipeTime;
-		#endif
+		}
 	}
 
 	Float4 PixelRoutine::interpolate(Float4 &x, Float4 &D, Float4 &rhw, Pointer<Byte> planeEquation, bool flat, bool perspective)
@@ -2038,15 +2046,21 @@ namespace sw
 
 	void PixelRoutine::sampleTexture(Registers &r, Vector4s &c, int stage, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &dsx, Vector4f &dsy, bool project, bool bias, bool gradients, bool lodProvided)
 	{
-		#if PERF_PROFILE
-			Long texTime = Ticks();
-		#endif
+		Long texTime;
+
+		if(state.profile)
+		{
+			texTime = Ticks();
+		}
+
+		ASSERT(!bias && !gradients && !lodProvided);   // Fixed-point results are only sampled with implicit LOD
 
 		Pointer<Byte> texture = r.data + OFFSET(DrawData,mipmap) + stage * sizeof(Texture);
+		Pointer<Byte> routine = *Pointer<Pointer<Byte> >(r.data + OFFSET(DrawData,samplerRoutine[stage][SAMPLE_FIXED]));
 
 		if(!project)
 		{
-			sampler[stage]->sampleTexture(texture, c, u, v, w, q, dsx, dsy, bias, gradients, lodProvided);
+			SamplerCore::call(routine, texture, r.constants, c, u, v, w, q);
 		}
 		else
 		{
@@ -2056,12 +2070,13 @@ namespace sw
 			Float4 v_q = v * rq;
 			Float4 w_q = w * rq;
 
-			sampler[stage]->sampleTexture(texture, c, u_q, v_q, w_q, q, dsx, dsy, bias, gradients, lodProvided);
+			SamplerCore::call(routine, texture, r.constants, c, u_q, v_q, w_q, q);
 		}
 
-		#if PERF_PROFILE
+		if(state.profile)
+		{
 			r.cycles[PERF_TEX] += Ticks() - texTime;
-		#endif
+		}
 	}
 
 	void PixelRoutine::sampleTexture(Registers &r, Vector4f &c, const Src &sampler, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &dsx, Vector4f &dsy, bool project, bool bias, bool gradients, bool lodProvided)
@@ -2090,15 +2105,21 @@ namespace sw
 
 	void PixelRoutine::sampleTexture(Registers &r, Vector4f &c, int stage, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &dsx, Vector4f &dsy, bool project, bool bias, bool gradients, bool lodProvided)
 	{
-		#if PERF_PROFILE
-			Long texTime = Ticks();
-		#endif
+		Long texTime;
+
+		if(state.profile)
+		{
+			texTime = Ticks();
+		}
+
+		SamplerMethod method = SamplerCore::method(bias, gradients, lodProvided);
 
 		Pointer<Byte> texture = r.data + OFFSET(DrawData,mipmap) + stage * sizeof(Texture);
+		Pointer<Byte> routine = *Pointer<Pointer<Byte> >(r.data + OFFSET(DrawData,samplerRoutine[stage][method]));
 
 		if(!project)
 		{
-			sampler[stage]->sampleTexture(texture, c, u, v, w, q, dsx, dsy, bias, gradients, lodProvided);
+			SamplerCore::call(routine, texture, r.constants, c, u, v, w, q, dsx, dsy, method);
 		}
 		else
 		{
@@ -2108,12 +2129,13 @@ namespace sw
 			Float4 v_q = v * rq;
 			Float4 w_q = w * rq;
 
-			sampler[stage]->sampleTexture(texture, c, u_q, v_q, w_q, q, dsx, dsy, bias, gradients, lodProvided);
+			SamplerCore::call(routine, texture, r.constants, c, u_q, v_q, w_q, q, dsx, dsy, method);
 		}
 
-		#if PERF_PROFILE
+		if(state.profile)
+		{
 			r.cycles[PERF_TEX] += Ticks() - texTime;
-		#endif
+		}
 	}
 
 	void PixelRoutine::clampColor(Vector4f oC[4])
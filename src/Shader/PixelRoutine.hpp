@@ -23,7 +23,6 @@ namespace sw
 	extern bool forceClearRegisters;
 
 	class PixelShader;
-	class SamplerCore;
 
 	class PixelRoutine : public Rasterizer, public ShaderCore
 	{
@@ -67,13 +66,6 @@ namespace sw
 				}
 
 				occlusion = 0;
-				
-				#if PERF_PROFILE
-					for(int i = 0; i < PERF_TIMERS; i++)
-					{
-						cycles[i] = 0;
-					}
-				#endif
 			}
 
 			Pointer<Byte> constants;
@@ -139,9 +131,7 @@ namespace sw
 
 			UInt occlusion;
 
-			#if PERF_PROFILE
-				Long cycles[PERF_TIMERS];
-			#endif
+			Long cycles[PERF_TIMERS];   // Only used when profiling
 		};
 
 		typedef Shader::DestinationParameter Dst;
@@ -298,8 +288,6 @@ namespace sw
 		const PixelShader *const shader;
 
 	private:
-		SamplerCore *sampler[TEXTURE_IMAGE_UNITS];
-
 		bool perturbate;
 		bool luminance;
 		bool previousScaling;
@@ -147,6 +147,21 @@ namespace sw
 		analyzeDynamicIndexing();
 	}
 
+	void PixelShader::computeID(uint64_t h[2]) const
+	{
+		Shader::computeID(h);
+
+		for(int i = 0; i < MAX_INPUT_VARYINGS; i++)
+		{
+			for(int j = 0; j < 4; j++)
+			{
+				hash(h, semantic[i][j].usage | semantic[i][j].index << 8 | semantic[i][j].centroid << 16);
+			}
+		}
+
+		hash(h, vPosDeclared | vFaceDeclared << 1);
+	}
+
 	void PixelShader::analyzeZOverride()
 	{
 		zOverride = false;
@@ -40,6 +40,9 @@ namespace sw
 		bool vPosDeclared;
 		bool vFaceDeclared;
 
+	protected:
+		virtual void computeID(uint64_t h[2]) const;
+
 	private:
 		void analyzeZOverride();
 		void analyzeKill();
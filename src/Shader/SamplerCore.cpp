@@ -20,16 +20,141 @@ namespace sw
 	{
 	}
 
+	Routine *SamplerCore::generate(const Sampler::State &state, SamplerMethod method)
+	{
+		Function<Void, Pointer<Byte>, Pointer<Byte>, Pointer<Byte> > function(RoutineSampler);
+		{
+			Pointer<Byte> texture(function.arg(0));
+			Pointer<Byte> parameters(function.arg(1));
+			Pointer<Byte> constants(function.arg(2));
+
+			Float4 u = *Pointer<Float4>(parameters + OFFSET(SamplerParameters,u), 16);
+			Float4 v = *Pointer<Float4>(parameters + OFFSET(SamplerParameters,v), 16);
+			Float4 w = *Pointer<Float4>(parameters + OFFSET(SamplerParameters,w), 16);
+			Float4 q = *Pointer<Float4>(parameters + OFFSET(SamplerParameters,q), 16);
+
+			bool bias = method == SAMPLE_BIAS || method == SAMPLE_GRADIENTS_BIAS;
+			bool gradients = method == SAMPLE_GRADIENTS || method == SAMPLE_GRADIENTS_BIAS;
+			bool lodProvided = method == SAMPLE_LOD;
+
+			Vector4f dsx;
+			Vector4f dsy;
+
+			if(gradients)
+			{
+				for(int i = 0; i < 3; i++)
+				{
+					dsx[i] = *Pointer<Float4>(parameters + OFFSET(SamplerParameters,dsx[i]), 16);
+					dsy[i] = *Pointer<Float4>(parameters + OFFSET(SamplerParameters,dsy[i]), 16);
+				}
+			}
+
+			SamplerCore sampler(constants, state);
+
+			if(method == SAMPLE_FIXED)
+			{
+				Vector4s c;
+
+				sampler.sampleTexture(texture, c, u, v, w, q, dsx, dsy);
+
+				for(int i = 0; i < 4; i++)
+				{
+					*Pointer<Short4>(parameters + OFFSET(SamplerParameters,c) + 8 * i, 8) = c[i];
+				}
+			}
+			else
+			{
+				Vector4f c;
+
+				sampler.sampleTexture(texture, c, u, v, w, q, dsx, dsy, bias, gradients, lodProvided);
+
+				for(int i = 0; i < 4; i++)
+				{
+					*Pointer<Float4>(parameters + OFFSET(SamplerParameters,c[i]), 16) = c[i];
+				}
+			}
+
+			Return();
+		}
+
+		Routine *routine = function(L"SamplerRoutine");
+		routine->setPrecachable(!state.profile);   // Counters are in the process's own profiler
+
+		return routine;
+	}
+
+	SamplerMethod SamplerCore::method(bool bias, bool gradients, bool lodProvided)
+	{
+		if(lodProvided)
+		{
+			return SAMPLE_LOD;
+		}
+		else if(gradients)
+		{
+			return bias ? SAMPLE_GRADIENTS_BIAS : SAMPLE_GRADIENTS;
+		}
+		else
+		{
+			return bias ? SAMPLE_BIAS : SAMPLE_IMPLICIT;
+		}
+	}
+
+	void SamplerCore::call(Pointer<Byte> &routine, Pointer<Byte> &texture, Pointer<Byte> &constants, Vector4s &c, Float4 &u, Float4 &v, Float4 &w, Float4 &q)
+	{
+		Array<Float4, sizeof(SamplerParameters) / sizeof(float4)> parameters;
+		Pointer<Byte> buffer = &parameters;
+
+		*Pointer<Float4>(buffer + OFFSET(SamplerParameters,u), 16) = u;
+		*Pointer<Float4>(buffer + OFFSET(SamplerParameters,v), 16) = v;
+		*Pointer<Float4>(buffer + OFFSET(SamplerParameters,w), 16) = w;
+		*Pointer<Float4>(buffer + OFFSET(SamplerParameters,q), 16) = q;
+
+		Call(routine, texture, buffer, constants);
+
+		for(int i = 0; i < 4; i++)
+		{
+			c[i] = *Pointer<Short4>(buffer + OFFSET(SamplerParameters,c) + 8 * i, 8);
+		}
+	}
+
+	void SamplerCore::call(Pointer<Byte> &routine, Pointer<Byte> &texture, Pointer<Byte> &constants, Vector4f &c, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &dsx, Vector4f &dsy, SamplerMethod method)
+	{
+		Array<Float4, sizeof(SamplerParameters) / sizeof(float4)> parameters;
+		Pointer<Byte> buffer = &parameters;
+
+		*Pointer<Float4>(buffer + OFFSET(SamplerParameters,u), 16) = u;
+		*Pointer<Float4>(buffer + OFFSET(SamplerParameters,v), 16) = v;
+		*Pointer<Float4>(buffer + OFFSET(SamplerParameters,w), 16) = w;
+		*Pointer<Float4>(buffer + OFFSET(SamplerParameters,q), 16) = q;
+
+		if(method == SAMPLE_GRADIENTS || method == SAMPLE_GRADIENTS_BIAS)
+		{
+			for(int i = 0; i < 3; i++)
+			{
+				*Pointer<Float4>(buffer + OFFSET(SamplerParameters,dsx[i]), 16) = dsx[i];
+				*Pointer<Float4>(buffer + OFFSET(SamplerParameters,dsy[i]), 16) = dsy[i];
+			}
+		}
+
+		Call(routine, texture, buffer, constants);
+
+		for(int i = 0; i < 4; i++)
+		{
+			c[i] = *Pointer<Float4>(buffer + OFFSET(SamplerParameters,c[i]), 16);
+		}
+	}
+
 	void SamplerCore::sampleTexture(Pointer<Byte> &texture, Vector4s &c, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &dsx, Vector4f &dsy, bool bias, bool gradients, bool lodProvided, bool fixed12)
 	{
-		#if PERF_PROFILE
+		if(state.profile)
+		{
 			AddAtomic(Pointer<Long>(&profiler.texOperations), 4);
 
 			if(state.compressedFormat)
 			{
 				AddAtomic(Pointer<Long>(&profiler.compressedTex), 4);
 			}
-		#endif
+		}
 
 		bool cubeTexture = state.textureType == TEXTURE_CUBE;
 		bool volumeTexture = state.textureType == TEXTURE_3D;
@@ -216,14 +341,15 @@ namespace sw
 
 	void SamplerCore::sampleTexture(Pointer<Byte> &texture, Vector4f &c, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &dsx, Vector4f &dsy, bool bias, bool gradients, bool lodProvided)
 	{
-		#if PERF_PROFILE
+		if(state.profile)
+		{
 			AddAtomic(Pointer<Long>(&profiler.texOperations), 4);
 
 			if(state.compressedFormat)
 			{
 				AddAtomic(Pointer<Long>(&profiler.compressedTex), 4);
 			}
-		#endif
+		}
 
 		bool cubeTexture = state.textureType == TEXTURE_CUBE;
 		bool volumeTexture = state.textureType == TEXTURE_3D;
@@ -17,6 +17,17 @@
 
 namespace sw
 {
+	struct SamplerParameters   // Arguments and result of a sampler routine
+	{
+		float4 u;
+		float4 v;
+		float4 w;
+		float4 q;
+		float4 dsx[3];   // Gradient methods only
+		float4 dsy[3];
+		float4 c[4];     // Four Short4 in the first two for SAMPLE_FIXED
+	};
+
 	class SamplerCore
 	{
 	public:
@@ -25,6 +36,13 @@ namespace sw
 		void sampleTexture(Pointer<Byte> &texture, Vector4s &c, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &dsx, Vector4f &dsy, bool bias = false, bool gradients = false, bool lodProvided = false, bool fixed12 = true);
 		void sampleTexture(Pointer<Byte> &texture, Vector4f &c, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &dsx, Vector4f &dsy, bool bias = false, bool gradients = false, bool lodProvided = false);
 
+		static Routine *generate(const Sampler::State &state, SamplerMethod method);
+		static SamplerMethod method(bool bias, bool gradients, bool lodProvided);
+
+		// Sample through a routine from generate(), instead of inlining the sampling code
+		static void call(Pointer<Byte> &routine, Pointer<Byte> &texture, Pointer<Byte> &constants, Vector4s &c, Float4 &u, Float4 &v, Float4 &w, Float4 &q);
+		static void call(Pointer<Byte> &routine, Pointer<Byte> &texture, Pointer<Byte> &constants, Vector4f &c, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &dsx, Vector4f &dsy, SamplerMethod method);
+
 	private:
 		void border(Short4 &mask, Float4 &coordinates);
 		void border(Int4 &mask, Float4 &coordinates);
@@ -32,9 +32,9 @@ namespace sw
 	{
 	}
 
-	void SetupRoutine::generate()
+	void SetupRoutine::generate(bool optimize)
 	{
-		Function<Bool, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte> > function;
+		Function<Bool, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte> > function(RoutineSetup, optimize);
 		{
 			Pointer<Byte> primitive(function.arg(0));
 			Pointer<Byte> tri(function.arg(1));
@@ -163,6 +163,8 @@ namespace sw
 			// Vertical range
 			Int yMin = Y[0];
 			Int yMax = Y[0];
+			Int xMin = X[0];
+			Int xMax = X[0];
 			
 			Int i = 1;
 			
@@ -170,6 +172,8 @@ namespace sw
 			{
 				yMin = Min(Y[i], yMin);
 				yMax = Max(Y[i], yMax);
+				xMin = Min(X[i], xMin);
+				xMax = Max(X[i], xMax);
 
 				i++;
 			}
@@ -186,13 +190,21 @@ namespace sw
 				yMax = (yMax + 0x0F) >> 4;
 			}
 
-			If(yMin == yMax)
+			yMin = Max(yMin, *Pointer<Int>(data + OFFSET(DrawData,scissorY0)));
+			yMax = Min(yMax, *Pointer<Int>(data + OFFSET(DrawData,scissorY1)));
+
+			If(yMin >= yMax)   // Also when scissored away, for the outline to never be written outside its rows
 			{
 				Return(false);
 			}
 
-			yMin = Max(yMin, *Pointer<Int>(data + OFFSET(DrawData,scissorY0)));
-			yMax = Min(yMax, *Pointer<Int>(data + OFFSET(DrawData,scissorY1)));
+			// A pixel of margin covers the pixel center and sample offsets
+			xMin = Max((xMin >> 4) - 1, *Pointer<Int>(data + OFFSET(DrawData,scissorX0)));
+			xMax = Min((xMax >> 4) + 2, *Pointer<Int>(data + OFFSET(DrawData,scissorX1)));
+
+			// Each sample's outline takes rows yMin - 1 to yMax of the span buffer, biased to be indexed by y
+			Pointer<Byte> spans = *Pointer<Pointer<Byte> >(primitive + OFFSET(Primitive,outline));
+			Int rows = yMax - yMin + 2;
 		
 			For(Int q = 0, q < state.multiSample, q++)
 			{
@@ -216,37 +228,67 @@ namespace sw
 				}
 				Until(i >= n)
 
-				Pointer<Byte> leftEdge = Pointer<Byte>(primitive + OFFSET(Primitive,outline->left)) + q * sizeof(Primitive);
-				Pointer<Byte> rightEdge = Pointer<Byte>(primitive + OFFSET(Primitive,outline->right)) + q * sizeof(Primitive);
-
-				if(state.multiSample > 1)
-				{
-					Short x = Short((X[0] + 0xF) >> 4);
+				Pointer<Byte> outline = spans + (q * rows - (yMin - 1)) * sizeof(Primitive::Span);
+				*Pointer<Pointer<Byte> >(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline)) = outline;
 
-					For(Int y = yMin - 1, y < yMax + 1, y++)
-					{
-						*Pointer<Short>(leftEdge + y * sizeof(Primitive::Span)) = x;
-						*Pointer<Short>(rightEdge + y * sizeof(Primitive::Span)) = x;
-					}
-				}
+				Pointer<Byte> leftEdge = outline + OFFSET(Primitive::Span,left);
+				Pointer<Byte> rightEdge = outline + OFFSET(Primitive::Span,right);
 
 				Xq[n] = Xq[0];
 				Yq[n] = Yq[0];
 
-				// Rasterize
+				if(state.halfSpace)
 				{
+					Pointer<Byte> edges = primitive + q * sizeof(Primitive) + OFFSET(Primitive,edge);
+
 					Int i = 0;
 
 					Do
 					{
-						edge(primitive, data, Xq[i + 1 - d], Yq[i + 1 - d], Xq[i + d], Yq[i + d], q);
+						halfSpace(edges + (i >> 2) * sizeof(Primitive::EdgeGroup) + (i & 3) * sizeof(int), Xq[i + 1 - d], Yq[i + 1 - d], Xq[i + d], Yq[i + d]);
 
 						i++;
 					}
 					Until(i >= n)
+
+					For(i, (i & 3) != 0, i++)   // Unused edges of the last group cover everything
+					{
+						Pointer<Byte> edge = edges + (i >> 2) * sizeof(Primitive::EdgeGroup) + (i & 3) * sizeof(int);
+
+						*Pointer<Int>(edge + OFFSET(Primitive::EdgeGroup,A)) = 0;
+						*Pointer<Int>(edge + OFFSET(Primitive::EdgeGroup,B)) = 0;
+						*Pointer<Int>(edge + OFFSET(Primitive::EdgeGroup,C)) = 0;
+						*Pointer<Float>(edge + OFFSET(Primitive::EdgeGroup,Cf)) = Float(1.0e30f);
+					}
+				}
+				else
+				{
+					if(state.multiSample > 1)
+					{
+						Short x = Short((X[0] + 0xF) >> 4);
+
+						For(Int y = yMin - 1, y < yMax + 1, y++)
+						{
+							*Pointer<Short>(leftEdge + y * sizeof(Primitive::Span)) = x;
+							*Pointer<Short>(rightEdge + y * sizeof(Primitive::Span)) = x;
+						}
+					}
+
+					// Rasterize
+					{
+						Int i = 0;
+
+						Do
+						{
+							edge(primitive, data, Xq[i + 1 - d], Yq[i + 1 - d], Xq[i + d], Yq[i + d], q);
+
+							i++;
+						}
+						Until(i >= n)
+					}
 				}
 
-				if(state.multiSample == 1)
+				if(state.multiSample == 1 && !state.halfSpace)
 				{
 					For(yMin, yMin < yMax && *Pointer<Short>(leftEdge + yMin * sizeof(Primitive::Span)) == *Pointer<Short>(rightEdge + yMin * sizeof(Primitive::Span)), yMin++)
 					{
@@ -273,6 +315,13 @@ namespace sw
 			*Pointer<Int>(primitive + OFFSET(Primitive,yMin)) = yMin;
 			*Pointer<Int>(primitive + OFFSET(Primitive,yMax)) = yMax;
 
+			if(state.halfSpace)
+			{
+				*Pointer<Int>(primitive + OFFSET(Primitive,edgeGroups)) = (n + 3) >> 2;
+			}
+			*Pointer<Int>(primitive + OFFSET(Primitive,xMin)) = xMin;
+			*Pointer<Int>(primitive + OFFSET(Primitive,xMax)) = xMax;
+
 			// Sort by minimum y
 			if(solidTriangle && logPrecision >= WHQL)
 			{
@@ -565,8 +614,9 @@ namespace sw
 
 			Bool swap = Y2 < Y1;
 
-			Pointer<Byte> leftEdge = primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->left);
-			Pointer<Byte> rightEdge = primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right);
+			Pointer<Byte> outline = *Pointer<Pointer<Byte> >(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline));
+			Pointer<Byte> leftEdge = outline + OFFSET(Primitive::Span,left);
+			Pointer<Byte> rightEdge = outline + OFFSET(Primitive::Span,right);
 			Pointer<Byte> edge = IfThenElse(swap, rightEdge, leftEdge);
 
 			Int X0 = X1;
@@ -588,8 +638,9 @@ namespace sw
 				Int FDX12 = DX12 << 4;
 				Int FDY12 = DY12 << 4;
 
-				Int X = DX12 * ((y1 << 4) - Y1) + X1 * DY12;
-				Int x = X / FDY12;     // Edge
+				// Whole pixels of X1 are added after the division, for the products not to overflow on tall render targets
+				Int X = DX12 * ((y1 << 4) - Y1) + (X1 & 0xF) * DY12;
+				Int x = X / FDY12 + (X1 >> 4);     // Edge
 				Int d = X % FDY12;     // Error-term
 				Int ceil = -d >> 31;   // Ceiling division: remainder <= 0
 				x -= ceil;
@@ -623,6 +674,21 @@ namespace sw
 		}
 	}
 
+	void SetupRoutine::halfSpace(Pointer<Byte> edge, const Int &X1, const Int &Y1, const Int &X2, const Int &Y2)
+	{
+		Int DX = X2 - X1;
+		Int DY = Y2 - Y1;
+
+		// DY * (16 * x - X1) - DX * (16 * y - Y1) is positive right of the edge. Pixels on right and
+		// bottom edges are excluded, like for the outline, by biasing C by one.
+		Int bias = IfThenElse(DY < 0 || (DY == 0 && DX > 0), Int(1), Int(0));
+
+		*Pointer<Int>(edge + OFFSET(Primitive::EdgeGroup,A)) = DY << 4;
+		*Pointer<Int>(edge + OFFSET(Primitive::EdgeGroup,B)) = -DX << 4;
+		*Pointer<Int>(edge + OFFSET(Primitive::EdgeGroup,C)) = DX * Y1 - DY * X1 - bias;
+		*Pointer<Float>(edge + OFFSET(Primitive::EdgeGroup,Cf)) = Float(DX) * Float(Y1) - Float(DY) * Float(X1);
+	}
+
 	void SetupRoutine::conditionalRotate1(Bool condition, Pointer<Byte> &v0, Pointer<Byte> &v1, Pointer<Byte> &v2)
 	{
 		#if 0   // Rely on LLVM optimization
@@ -13,6 +13,7 @@
 
 #include "VertexShader.hpp"
 #include "PixelShader.hpp"
+#include "Sampler.hpp"
 #include "Math.hpp"
 #include "Debug.hpp"
 
@@ -23,8 +24,6 @@
 
 namespace sw
 {
-	volatile int Shader::serialCounter = 1;
-
 	Shader::Opcode Shader::OPCODE_DP(int i)
 	{
 		switch(i)
@@ -1053,9 +1052,12 @@ namespace sw
 		       analysisLeave;
 	}
 
-	Shader::Shader() : serialID(serialCounter++)
+	Shader::Shader()
 	{
 		usedSamplers = 0;
+		samplerMethods = 0;
+		id[0] = 0;
+		id[1] = 0;
 	}
 
 	Shader::~Shader()
@@ -1347,9 +1349,110 @@ namespace sw
 		return (usedSamplers & (1 << index)) != 0;
 	}
 
-	int Shader::getSerialID() const
+	unsigned int Shader::getSamplerMethods() const
+	{
+		return samplerMethods;
+	}
+
+	const uint64_t *Shader::getID() const
+	{
+		if(!id[0] && !id[1])
+		{
+			uint64_t h[2];
+			computeID(h);
+
+			// MurmurHash3 finalization
+			h[0] += h[1];
+			h[1] += h[0];
+
+			for(int i = 0; i < 2; i++)
+			{
+				h[i] ^= h[i] >> 33;
+				h[i] *= 0xFF51AFD7ED558CCDULL;
+				h[i] ^= h[i] >> 33;
+				h[i] *= 0xC4CEB9FE1A85EC53ULL;
+				h[i] ^= h[i] >> 33;
+			}
+
+			h[0] += h[1];
+			h[1] += h[0];
+
+			id[0] = (h[0] || h[1]) ? h[0] : 1;   // Zero is reserved for no shader
+			id[1] = h[1];
+		}
+
+		return id;
+	}
+
+	void Shader::computeID(uint64_t h[2]) const
+	{
+		h[0] = 0x9E3779B97F4A7C15ULL;
+		h[1] = 0x7F4A7C159E3779B9ULL;
+
+		hash(h, shaderType);
+		hash(h, version);
+		hash(h, usedSamplers);
+		hash(h, instruction.size());
+
+		for(unsigned int i = 0; i < instruction.size(); i++)
+		{
+			const Instruction *inst = instruction[i];
+
+			hash(h, inst->opcode);
+			hash(h, inst->control);
+			hash(h, inst->predicate | inst->predicateNot << 1 | inst->coissue << 2 | inst->predicateSwizzle << 8 | inst->usageIndex << 16);
+			hash(h, inst->samplerType);
+			hash(h, inst->usage);
+			hash(h, inst->analysis);
+
+			hash(h, inst->dst);
+			hash(h, inst->dst.mask | inst->dst.integer << 4 | inst->dst.saturate << 5 | inst->dst.partialPrecision << 6 | inst->dst.centroid << 7 | (inst->dst.shift & 0xF) << 8);
+
+			for(int j = 0; j < 4; j++)
+			{
+				hash(h, inst->src[j]);
+				hash(h, inst->src[j].swizzle | inst->src[j].modifier << 8);
+			}
+		}
+	}
+
+	void Shader::hash(uint64_t h[2], uint64_t value)
 	{
-		return serialID;
+		// MurmurHash3 x64 128-bit mixing step, one value into both halves
+		const uint64_t c1 = 0x87C37B91114253D5ULL;
+		const uint64_t c2 = 0x4CF5AD432745937FULL;
+
+		uint64_t k1 = value * c1;
+		k1 = (k1 << 31) | (k1 >> 33);
+		h[0] ^= k1 * c2;
+		h[0] = (h[0] << 27) | (h[0] >> 37);
+		h[0] += h[1];
+		h[0] = h[0] * 5 + 0x52DCE729;
+
+		uint64_t k2 = value * c2;
+		k2 = (k2 << 33) | (k2 >> 31);
+		h[1] ^= k2 * c1;
+		h[1] = (h[1] << 31) | (h[1] >> 33);
+		h[1] += h[0];
+		h[1] = h[1] * 5 + 0x38495AB5;
+	}
+
+	void Shader::hash(uint64_t h[2], const Parameter &parameter)
+	{
+		hash(h, parameter.type);
+
+		switch(parameter.type)
+		{
+		case PARAMETER_FLOAT4LITERAL:
+		case PARAMETER_BOOL1LITERAL:
+		case PARAMETER_INT4LITERAL:
+			hash(h, (unsigned int)parameter.integer[0] | (uint64_t)(unsigned int)parameter.integer[1] << 32);
+			hash(h, (unsigned int)parameter.integer[2] | (uint64_t)(unsigned int)parameter.integer[3] << 32);
+			break;
+		default:   // Padding is left out, it isn't initialized
+			hash(h, parameter.index | (uint64_t)parameter.rel.type << 32 | (uint64_t)parameter.rel.swizzle << 40 | (uint64_t)parameter.rel.deterministic << 48);
+			hash(h, parameter.rel.index | (uint64_t)parameter.rel.scale << 32);
+		}
 	}
 
 	size_t Shader::getLength() const
@@ -1394,11 +1497,15 @@ namespace sw
 	void Shader::append(Instruction *instruction)
 	{
 		this->instruction.push_back(instruction);
+		id[0] = 0;
+		id[1] = 0;
 	}
 
 	void Shader::declareSampler(int i)
 	{
 		usedSamplers |= 1 << i;
+		id[0] = 0;
+		id[1] = 0;
 	}
 
 	const Shader::Instruction *Shader::getInstruction(unsigned int i) const
@@ -1413,6 +1520,8 @@ namespace sw
 		optimizeLeave();
 		optimizeCall();
 		removeNull();
+		id[0] = 0;
+		id[1] = 0;
 	}
 
 	void Shader::optimizeLeave()
@@ -1752,6 +1861,28 @@ namespace sw
 					{
 						usedSamplers |= 1 << dst.index;
 					}
+
+					// Methods are per shader, so samplers indexed dynamically are covered
+					if(shaderType == SHADER_VERTEX)
+					{
+						samplerMethods |= 1 << SAMPLE_LOD;
+					}
+					else if(version <= 0x0104)
+					{
+						samplerMethods |= 1 << SAMPLE_FIXED;
+					}
+					else if(instruction[i]->opcode == OPCODE_TEXLDL)
+					{
+						samplerMethods |= 1 << SAMPLE_LOD;
+					}
+					else if(instruction[i]->opcode == OPCODE_TEXLDD)
+					{
+						samplerMethods |= 1 << (instruction[i]->bias ? SAMPLE_GRADIENTS_BIAS : SAMPLE_GRADIENTS);
+					}
+					else
+					{
+						samplerMethods |= 1 << (instruction[i]->bias ? SAMPLE_BIAS : SAMPLE_IMPLICIT);
+					}
 				}
 				break;
 			}
@@ -496,7 +496,7 @@ namespace sw
 
 		virtual ~Shader();
 
-		int getSerialID() const;
+		const uint64_t *getID() const;   // 128-bit hash of the contents, so identical shaders share routines
 		size_t getLength() const;
 		ShaderType getShaderType() const;
 		unsigned short getVersion() const;
@@ -521,6 +521,7 @@ namespace sw
 		bool containsLeaveInstruction() const;
 		bool containsDefineInstruction() const;
 		bool usesSampler(int i) const;
+		unsigned int getSamplerMethods() const;   // Bit flags, by SamplerMethod
 
 		struct Semantic
 		{
@@ -569,6 +570,10 @@ namespace sw
 		void analyzeDynamicIndexing();
 		void markFunctionAnalysis(int functionLabel, Analysis flag);
 
+		virtual void computeID(uint64_t h[2]) const;   // Derived shaders add their declarations
+		static void hash(uint64_t h[2], uint64_t value);
+		static void hash(uint64_t h[2], const Parameter &parameter);
+
 		ShaderType shaderType;
 
 		union
@@ -585,10 +590,10 @@ namespace sw
 		std::vector<Instruction*> instruction;
 
 		unsigned short usedSamplers;   // Bit flags
+		unsigned char samplerMethods;   // Bit flags
 
 	private:
-		const int serialID;
-		static volatile int serialCounter;
+		mutable uint64_t id[2];   // Computed on first use, since linking may still modify the declarations
 
 		bool dynamicBranching;
 		bool containsBreak;
@@ -36,19 +36,10 @@ namespace sw
 
 	VertexProgram::~VertexProgram()
 	{
-		for(int i = 0; i < VERTEX_TEXTURE_IMAGE_UNITS; i++)
-		{
-			delete sampler[i];
-		}
 	}
 
 	void VertexProgram::pipeline(Registers &r)
 	{
-		for(int i = 0; i < VERTEX_TEXTURE_IMAGE_UNITS; i++)
-		{
-			sampler[i] = new SamplerCore(r.constants, state.samplerState[i]);
-		}
-
 		if(!state.preTransformed)
 		{
 			program(r);
@@ -1453,8 +1444,7 @@ namespace sw
 	{
 		if(s.type == Shader::PARAMETER_SAMPLER && s.rel.type == Shader::PARAMETER_VOID)
 		{
-			Pointer<Byte> texture = r.data + OFFSET(DrawData,mipmap[16]) + s.index * sizeof(Texture);
-			sampler[s.index]->sampleTexture(texture, c, u, v, w, q, r.a0, r.a0, false, false, true);	
+			sampleTexture(r, c, s.index, u, v, w, q);
 		}
 		else
 		{
@@ -1466,12 +1456,19 @@ namespace sw
 				{
 					If(index == i)
 					{
-						Pointer<Byte> texture = r.data + OFFSET(DrawData,mipmap[16]) + i * sizeof(Texture);
-						sampler[i]->sampleTexture(texture, c, u, v, w, q, r.a0, r.a0, false, false, true);
+						sampleTexture(r, c, i, u, v, w, q);
 						// FIXME: When the sampler states are the same, we could use one sampler and just index the texture
 					}
 				}
 			}
 		}
 	}
+
+	void VertexProgram::sampleTexture(Registers &r, Vector4f &c, int stage, Float4 &u, Float4 &v, Float4 &w, Float4 &q)
+	{
+		Pointer<Byte> texture = r.data + OFFSET(DrawData,mipmap[16]) + stage * sizeof(Texture);
+		Pointer<Byte> routine = *Pointer<Pointer<Byte> >(r.data + OFFSET(DrawData,samplerRoutine[16 + stage][SAMPLE_LOD]));
+
+		SamplerCore::call(routine, texture, r.constants, c, u, v, w, q, r.a0, r.a0, SAMPLE_LOD);
+	}
 }
@@ -22,7 +22,6 @@ namespace sw
 {
 	struct Stream;
 	class VertexShader;
-	class SamplerCore;
 
 	class VertexProgram : public VertexRoutine, public ShaderCore
 	{
@@ -81,8 +80,7 @@ namespace sw
 		void TEX(Registers &r, Vector4f &dst, Vector4f &src, const Src&);
 
 		void sampleTexture(Registers &r, Vector4f &c, const Src &s, Float4 &u, Float4 &v, Float4 &w, Float4 &q);
-
-		SamplerCore *sampler[VERTEX_TEXTURE_IMAGE_UNITS];
+		void sampleTexture(Registers &r, Vector4f &c, int stage, Float4 &u, Float4 &v, Float4 &w, Float4 &q);
 
 		int ifDepth;
 		int loopRepDepth;
@@ -32,9 +32,9 @@ namespace sw
 	{
 	}
 
-	void VertexRoutine::generate()
+	void VertexRoutine::generate(bool optimize)
 	{
-		Function<Void, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte> > function;
+		Function<Void, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte> > function(RoutineVertex, optimize);
 		{
 			Pointer<Byte> vertex(function.arg(0));
 			Pointer<Byte> batch(function.arg(1));
@@ -89,7 +89,7 @@ namespace sw
 			Return();
 		}
 
-		routine = function(L"VertexRoutine_%0.8X", state.shaderID);
+		routine = function(L"VertexRoutine_%0.8X", (unsigned int)state.shaderID[0]);
 	}
 
 	Routine *VertexRoutine::getRoutine()
@@ -76,7 +76,7 @@ namespace sw
 
 		virtual ~VertexRoutine();
 
-		void generate();
+		void generate(bool optimize = true);
 		Routine *getRoutine();
 
 	protected:
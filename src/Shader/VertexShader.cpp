@@ -158,6 +158,27 @@ namespace sw
 		analyzeDynamicIndexing();
 	}
 
+	void VertexShader::computeID(uint64_t h[2]) const
+	{
+		Shader::computeID(h);
+
+		hash(h, (unsigned int)positionRegister | (uint64_t)(unsigned int)pointSizeRegister << 32);
+		hash(h, instanceIdDeclared);
+
+		for(int i = 0; i < MAX_INPUT_ATTRIBUTES; i++)
+		{
+			hash(h, input[i].usage | input[i].index << 8);
+		}
+
+		for(int i = 0; i < MAX_OUTPUT_VARYINGS; i++)
+		{
+			for(int j = 0; j < 4; j++)
+			{
+				hash(h, output[i][j].usage | output[i][j].index << 8);
+			}
+		}
+	}
+
 	void VertexShader::analyzeInput()
 	{
 		for(unsigned int i = 0; i < instruction.size(); i++)
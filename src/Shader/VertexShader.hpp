@@ -40,6 +40,9 @@ namespace sw
 		enum {MAX_OUTPUT_VARYINGS = 12};
 		Semantic output[MAX_OUTPUT_VARYINGS][4];   // FIXME: Private
 
+	protected:
+		virtual void computeID(uint64_t h[2]) const;
+
 	private:
 		void analyzeInput();
 		void analyzeOutput();